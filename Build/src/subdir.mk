@@ -2,52 +2,80 @@
 CC_SRCS += \
 ../src/DiscreteCCSOpt.cc \
 ../src/Library_data.cc \
+../src/checkpoint.cc \
 ../src/chem_opt.cc \
 ../src/chemgroup.cc \
 ../src/chemident.cc \
 ../src/entropic_aux.cc \
+../src/eval_pool.cc \
+../src/evaluator_plugin.cc \
+../src/flat_zmat.cc \
 ../src/generalbaseiterator.cc \
 ../src/parse.cc \
+../src/result_cache.cc \
 ../src/simpleprune.cc \
+../src/synthetic_landscape.cc \
+../src/worker_pool.cc \
 ../src/zmat.cc \
 ../src/zmat_opt.cc 
 
 CC_DEPS += \
 ./src/DiscreteCCSOpt.d \
 ./src/Library_data.d \
+./src/checkpoint.d \
 ./src/chem_opt.d \
 ./src/chemgroup.d \
 ./src/chemident.d \
 ./src/entropic_aux.d \
+./src/eval_pool.d \
+./src/evaluator_plugin.d \
+./src/flat_zmat.d \
 ./src/generalbaseiterator.d \
 ./src/parse.d \
+./src/result_cache.d \
 ./src/simpleprune.d \
+./src/synthetic_landscape.d \
+./src/worker_pool.d \
 ./src/zmat.d \
 ./src/zmat_opt.d 
 
 OBJS += \
 ./src/DiscreteCCSOpt.o \
 ./src/Library_data.o \
+./src/checkpoint.o \
 ./src/chem_opt.o \
 ./src/chemgroup.o \
 ./src/chemident.o \
 ./src/entropic_aux.o \
+./src/eval_pool.o \
+./src/evaluator_plugin.o \
+./src/flat_zmat.o \
 ./src/generalbaseiterator.o \
 ./src/parse.o \
+./src/result_cache.o \
 ./src/simpleprune.o \
+./src/synthetic_landscape.o \
+./src/worker_pool.o \
 ./src/zmat.o \
 ./src/zmat_opt.o 
 
 DOBJS += \
 ./src/DiscreteCCSOpt.d.o \
 ./src/Library_data.d.o \
+./src/checkpoint.d.o \
 ./src/chem_opt.d.o \
 ./src/chemgroup.d.o \
 ./src/chemident.d.o \
 ./src/entropic_aux.d.o \
+./src/eval_pool.d.o \
+./src/evaluator_plugin.d.o \
+./src/flat_zmat.d.o \
 ./src/generalbaseiterator.d.o \
 ./src/parse.d.o \
+./src/result_cache.d.o \
 ./src/simpleprune.d.o \
+./src/synthetic_landscape.d.o \
+./src/worker_pool.d.o \
 ./src/zmat.d.o \
 ./src/zmat_opt.d.o
 
@@ -57,7 +85,7 @@ DOBJS += \
 src/%.o: ../src/%.cc
 	@echo 'Building file: $<'
 	@echo 'Invoking: GCC C++ Compiler'
-	$(CXX) -fpermissive -I$(BCRCPPLAROOT) -I.. -I../include -I../src -I"../" -O3 -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	$(CXX) -std=gnu++17 -fpermissive -I$(BCRCPPLAROOT) -I.. -I../include -I../src -I"../" -O3 -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
 	@echo 'Finished building: $<'
 	@echo ' '
 
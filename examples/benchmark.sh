@@ -0,0 +1,60 @@
+#!/bin/sh
+# Optimizer benchmark on synthetic landscapes.
+# usage: benchmark.sh [executable] [seconds per run]
+# Runs every method over a matrix of library shapes and landscapes with
+# --synthetic and prints one line per run: evaluations, the evaluation after
+# which the best feasible value was found, whether it is the optimum,
+# wall time and the time not spent evaluating (bookkeeping overhead).
+# Runs that do not finish in time are stopped and marked "interrupted".
+EXE=${1:-./DiscreteCCSOpt}
+LIMIT=${2:-30}
+case $EXE in /*) ;; *) EXE=`pwd`/$EXE ;; esac
+WORK=`mktemp -d`
+trap 'rm -rf $WORK' EXIT
+cd $WORK
+
+# library with $1 sites of $2 substituents each
+library() {
+ echo "ChemGroup("
+ echo "  ("
+ echo "   Z( (C, -3, 0(), -2, 0 (), -1, 0()) )"
+ echo "   ReturnConnector()"
+ echo "   Connector("
+ for s in `seq 1 $1`; do
+  echo "    ( (0,-1,-2) (1.5, 0, 0) (0, 109.47, 0) (0, 0, 120) (0, 0, 1) (0, 0, 1) (0, 0, 1) () )"
+ done
+ echo "   )"
+ echo "   allowed_groups("
+ for s in `seq 1 $1`; do
+  echo "    (`seq -s, 1 $2`)"
+ done
+ echo "   )"
+ echo "  )"
+ for g in `seq 1 $2`; do
+  echo "  ( Z( ( F, -3, 1.4(), -2, 0(), -1, 0()) ) ReturnConnector() Connector() allowed_groups() )"
+ done
+ echo ")"
+ echo "nconstraints(1)"
+}
+
+printf "%-10s %-6s %-10s %-40s %8s %8s %7s %10s %10s %s\n" landscape shape size method evals found_at optimum wall overhead status
+for shape in 4x4 6x6 8x8 12x4; do
+ library ${shape%x*} ${shape#*x} > lib.inp
+ for landscape in additive nk:2 rugged:8; do
+  for method in "-m BLS" "-m BLS -p" "-m GBLS -p" "-m GBGLS -p" \
+    "-m GDMC -sm BLS -T 1 -TS 3 -MS 200" "-m GDMC -sm GBGLS -p -T 1 -TS 3 -MS 200" \
+    "-m GBEN -sm BLS -TS 3 -MS 200" "-m GBEN -sm GBGLS -p -TS 3 -MS 200"; do
+   line=`timeout $LIMIT $EXE -f lib.inp $method --sc 0 --synthetic $landscape 2>/dev/null | grep -a "^Synthetic benchmark:"`
+   set -- $line
+   if [ $# -lt 10 ]; then
+    printf "%-10s %-6s %-10s %-40s %s\n" $landscape $shape - "$method" failed
+    continue
+   fi
+   eval `echo "$line" | sed -e 's/^Synthetic benchmark://' | awk '{for(i=1;i<NF;i+=2) printf "%s=\"%s\" ", $i, $(i+1)}'`
+   case $line in *interrupted) status=interrupted ;; *) status=done ;; esac
+   printf "%-10s %-6s %-10s %-40s %8s %8s %7s %10s %10s %s\n" $landscape $shape $size "$method" \
+    $evaluations $found_at ${reached:--} $wall_time $overhead $status
+   reached=
+  done
+ done
+done
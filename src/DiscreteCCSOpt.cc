@@ -63,8 +63,8 @@ will be taken from standard input interactively.
 Currently this includes <EM>BLS (binary_line_search), GBLS (gen_base_LS), GBGLS (gen_base_grad_LS), SD or sd or  steepest_descent (binary_steepest_descent)</EM>
 \param -m <method> \newline
 Supplies the method to be used. Options include all listed under sub-methods and <EM>
-GBEN (gen_base_entropic), GDMC (binary_gdmc, gen_base_gdmc)</EM>. The default is BLS.
-GDMC only accepts GBGLS, and BLS, whereas GBEN also accepts GBLS in addition.
+GBEN (gen_base_entropic), GDMC (binary_gdmc, gen_base_gdmc), ISLAND (island_model)</EM>. The default is BLS.
+GDMC and ISLAND only accept GBGLS, and BLS, whereas GBEN also accepts GBLS in addition.
 \param --pre For GBGLS, indicate that a full sweep of each search direction is to be performed prior to optimization.
 This is only useful if -p is also set.
 \param --atmax places substituents which have not been encountered previously in a GBGLS run with pruning at the top of the
@@ -74,14 +74,47 @@ the active substituent at the time of reordering.
 \param --minimax enforces adjustment of Lagrange multipliers \f$\lambda\f$ associated with constraints to solve the minimax problem
 over the set of molecules which have already been computed.
 \param -T <temperature> provides a fictitious temperature for GDMC calculations.
-\param -TS <steps> provides the number of steps to tighten selection criteria for GDMC or number of runs for GBEN.
-\param -MS <steps> Maximum number of evaluations used in GBEN and GDMC.
+\param --replicas <number> For GDMC with GBGLS, runs this many chains at once at the temperatures T, T*ladder, T*ladder^2, ...
+and exchanges their starting points by parallel tempering. The default is 1. The chains see each other's values only
+after each round, so the trajectories do not depend on --jobs. See gen_base_gdmc.
+\param --ladder <factor> Ratio of the temperatures of neighbouring chains for --replicas. The default is 2.
+\param -TS <steps> provides the number of steps to tighten selection criteria for GDMC, number of runs for GBEN or
+number of epochs for ISLAND.
+\param -MS <steps> Maximum number of evaluations used in GBEN, GDMC and ISLAND.
+\param --restarts <number> For GBEN, starts this many runs of the sub-method at once from mutually distant compounds
+(see maximize_entropic_distances()). The runs share the --jobs slots and see each other's results after the batch. The default is 1.
+\param --islands <number> For ISLAND, number of searches of the sub-method that run at once and exchange their best
+compounds and Lagrange multipliers after each epoch. The default is 2.
 \param --random-order Order substituents randomly for each site.
 \param --gben-reorder
 \param --gbenr requires that GBEN with GBGLS use the order established in the last run to assess the diversity metric.
 \param --enumerate Prints every Z-matrix and its corresponding library number
+\param --jobs <number> Number of external evaluations that may run concurrently (default 1).
+See eval_pool.
+\param --speculative Lets binary_line_search evaluate all bit flips of its reference at once, which keeps more than one job busy.
+Results it did not use are removed from the memo at the end of each sweep, so the trajectory and, after each sweep, the count of
+visited compounds equal those of a serial run.
+\param --keep-speculative Keeps the unused speculative results in the memo. They then count against -MS and similar budgets.
+\param --cache <filename> Keeps computed properties and conformer energies in filename and reuses them in later runs
+with the same ChemGroup input. See result_cache. The file must be removed if the external scripts change.
+\param --checkpoint <filename> For GDMC, GBEN and ISLAND, writes the state of the optimization to filename after each run of the
+sub-method. See checkpoint.
+\param --resume <filename> Continues a GDMC, GBEN or ISLAND optimization from a checkpoint. All other options must be the same as
+in the run that wrote the checkpoint.
+\param --worker <command> Sends Z-matrices to long-lived evaluator processes started with command instead of running
+energy_run and property_script for each of them. One worker is started per job. See worker_pool for the protocol and
+examples/script_worker for an adapter to the scripts.
+\param --pipe <command> Runs command <energy|property> <id> for each Z-matrix instead of energy_run or property_script. The
+Z-matrix is passed on standard input and the result is read from standard output as one RESULT line, so no scratch files
+are needed. See worker_pool for the record and examples/pipe_shim for an adapter to the scripts.
+\param --plugin "<library> [argument]" Computes energies and properties in-process with a shared library implementing
+dccso_plugin.h instead of the scripts or workers. The argument is passed to its dccso_init(). See evaluator_plugin.
+\param --synthetic <type>[:<parameter>][\@<seed>] Replaces the conformational analysis of every molecule by an analytic
+landscape over the substituents chosen at each site: additive, nk[:K] or rugged[:M]. Statistics on the number of
+evaluations are printed at exit. See synthetic_landscape and examples/benchmark.sh.
 
 \section install_sec Installation
+The code requires C++17 with floating-point std::to_chars, e.g., GCC 11 or newer; the makefiles pass -std=gnu++17.
 - Untar and unzip the tarball. The source will be extracted into <CODE>DiscreteCCSOpt/</CODE>.
 - Change direcory to DiscreteCCSOpt/Build and edit Doxyfile to change the documentation path to your liking.
 - make 
@@ -115,6 +148,13 @@ The executable will be named <EM>DiscreteCCSOpt</EM>.
 #include <genbasegdmc.hh>
 #include <gen_base_entropic.hh>
 #include <binary_entropic.hh>
+#include <island_model.hh>
+#include <eval_pool.hh>
+#include <result_cache.hh>
+#include <checkpoint.hh>
+#include <worker_pool.hh>
+#include <evaluator_plugin.hh>
+#include <synthetic_landscape.hh>
 #include "parse.hh"
 
 using namespace std;
@@ -130,11 +170,35 @@ valerg calc_property(const zmat& A, const string& out, const string& id, zmat& r
    valerg value;
    value.property=-INFINITY;
    value.energy=INFINITY;
-   value.penalty=refvector<double>(nconstraints);
+   value.penalty=penalty_vector(nconstraints);
    for(long i=0;i<nconstraints;i++) value.penalty[i]=INFINITY;
    value.property_computed=false;
    value.energy_computed=false;
 
+   if(evaluator_plugin::is_active())
+      return evaluator_plugin::evaluate("property",A,out,id,returnA,nconstraints);
+   if(worker_pool::is_active()) {
+      worker_result r;
+      if(!worker_pool::request("property",out,id,r)) return value;
+      value.property_computed=true;
+      value.energy_computed=true;
+      value.property=r.property;
+      value.energy=r.energy;
+      for(long i=0;i<nconstraints && i<r.penalty.size();i++)
+         value.penalty[i]=r.penalty[i];
+      returnA=A;
+      if(r.consts.size()>=A.count_constants() && r.vars.size()>=A.count_variables())
+         returnA.set_constants_variables(r.consts,r.vars);
+      return value;
+   }
+
+   // The energy run of id usually wrote this file already, unless its energy came from the result_cache.
+   {
+      s=id+".zmat";
+      ofstream output_file(s.c_str());
+      output_file << out << endl;
+      output_file.close();
+   }
    s="./property_script "+id+"\n";
 
    int r=system(s.c_str());
@@ -231,6 +295,10 @@ int main(int argc, char *argv[])
       double value=0.0;
       long max_steps=1;
       long tight_steps=1;
+      long restarts=1;
+      long islands=2;
+      long replicas=1;
+      double ladder=2.0;
       bool pruned=false;
       bool precondition_flag=false;
       bool at_max_flag=false;
@@ -241,11 +309,16 @@ int main(int argc, char *argv[])
       bool enumerateflag=false;
       bool value_passed=false;
       bool gbenreorderflag=false;
+      string worker_command="";
+      string pipe_command="";
 
       cout << "Invocation:" << endl;
       for(int i=0;i<argc;i++)
          cout << argv[i] << endl;
 
+      // random() must use a state that checkpoints can save.
+      checkpoint::init_random();
+
       for (int i=1;i<argc;i++)
       {
          string command=argv[i];
@@ -286,6 +359,38 @@ int main(int argc, char *argv[])
                cout << "Number of tightenings of constraints: " << tight_steps << endl;
             }
          }
+         else if(command=="--restarts")  {
+            if(argc>i+1) {
+               stringstream s;
+               s << argv[++i];
+               s >> restarts;
+               cout << "Concurrent runs of GBEN: " << restarts << endl;
+            }
+         }
+         else if(command=="--islands")  {
+            if(argc>i+1) {
+               stringstream s;
+               s << argv[++i];
+               s >> islands;
+               cout << "Number of islands: " << islands << endl;
+            }
+         }
+         else if(command=="--replicas")  {
+            if(argc>i+1) {
+               stringstream s;
+               s << argv[++i];
+               s >> replicas;
+               cout << "Number of replicas: " << replicas << endl;
+            }
+         }
+         else if(command=="--ladder")  {
+            if(argc>i+1) {
+               stringstream s;
+               s << argv[++i];
+               s >> ladder;
+               cout << "Temperature ladder: " << ladder << endl;
+            }
+         }
          else if(command=="--pre"){
             precondition_flag=true;
          }
@@ -310,6 +415,57 @@ int main(int argc, char *argv[])
          else if(command=="--enumerate") {
             enumerateflag=true;
          }
+         else if(command=="--jobs") {
+            if(argc>i+1) {
+               stringstream s;
+               long jobs=1;
+               s << argv[++i];
+               s >> jobs;
+               eval_pool::set_jobs(jobs);
+               cout << "Concurrent evaluations: " << eval_pool::get_jobs() << endl;
+            }
+         }
+         else if(command=="--speculative") {
+            eval_pool::set_speculative(true);
+         }
+         else if(command=="--keep-speculative") {
+            eval_pool::set_speculative(true);
+            eval_pool::set_keep_speculative(true);
+         }
+         else if(command=="--cache") {
+            if(argc>i+1)
+               result_cache::open(argv[++i]);
+         }
+         else if(command=="--checkpoint") {
+            if(argc>i+1)
+               checkpoint::set_file(argv[++i]);
+         }
+         else if(command=="--resume") {
+            if(argc>i+1)
+               checkpoint::set_resume(argv[++i]);
+         }
+         else if(command=="--worker") {
+            if(argc>i+1)
+               worker_command=argv[++i];
+         }
+         else if(command=="--pipe") {
+            if(argc>i+1)
+               pipe_command=argv[++i];
+         }
+         else if(command=="--plugin") {
+            if(argc>i+1) {
+               string plugin=argv[++i];
+               size_t blank=plugin.find(' ');
+               if(blank==string::npos)
+                  evaluator_plugin::load(plugin,"");
+               else
+                  evaluator_plugin::load(plugin.substr(0,blank),plugin.substr(blank+1));
+            }
+         }
+         else if(command=="--synthetic") {
+            if(argc>i+1)
+               synthetic_landscape::configure(argv[++i]);
+         }
          else if(command=="--start_compound" || command =="--sc") {
             value_passed=true;
             if(argc>i+1) {
@@ -321,6 +477,12 @@ int main(int argc, char *argv[])
          }
       }
 
+      // The number of workers follows --jobs, wherever it appears on the command line.
+      if(worker_command!="")
+         worker_pool::start(worker_command,eval_pool::get_jobs());
+      else if(pipe_command!="")
+         worker_pool::start_per_request(pipe_command);
+
       if(filename!="")
          in.open(filename.c_str());
       else {
@@ -489,6 +651,8 @@ int main(int argc, char *argv[])
                   C.T=T;
                   C.tight_steps=tight_steps;
                   C.max_steps=max_steps;
+                  C.replicas=replicas;
+                  C.ladder=ladder;
                   cout << "top=gen_base_gdmc<gen_base_grad_LS<reorder_general_base<chem_opt> > >\n";
                   C.set_id("top");
 
@@ -508,6 +672,8 @@ int main(int argc, char *argv[])
                   C.T=T;
                   C.tight_steps=tight_steps;
                   C.max_steps=max_steps;
+                  C.replicas=replicas;
+                  C.ladder=ladder;
                   cout << "top=gen_base_gdmc<gen_base_grad_LS<noprune<chem_opt> > >\n";
                   C.set_id("top");
 
@@ -539,6 +705,7 @@ int main(int argc, char *argv[])
                   typedef binary_entropic<CC_t> C_t;
                   C_t C(CC);
                   C.max_steps=max_steps;
+                  C.restarts=restarts;
                   cout << "top=binary_entropic<binary_line_search<simple_prune<has_gradients_data<chem_opt> > > >\n";
                   C.set_id("top");
 
@@ -554,6 +721,7 @@ int main(int argc, char *argv[])
                   typedef binary_entropic<CC_t> C_t;
                   C_t C(CC);
                   C.max_steps=max_steps;
+                  C.restarts=restarts;
                   cout << "top=binary_entropic<binary_line_search<noprune<has_gradients_data<chem_opt> > > >\n";
                   C.set_id("top");
 
@@ -590,6 +758,7 @@ int main(int argc, char *argv[])
                   typedef gen_base_entropic<gen_base_grad_LS<CC_t,general_base_iterator<chem_opt> > > C_t;
                   C_t C(CCC,bases,gbenreorderflag);
                   C.max_steps=max_steps;
+                  C.restarts=restarts;
                   C.nruns=tight_steps;
                   cout << "top=gen_base_entropic<gen_base_grad_LS<reorder_general_base<chem_opt> > >\n";
                   C.set_id("top");
@@ -607,6 +776,7 @@ int main(int argc, char *argv[])
                   typedef gen_base_entropic<gen_base_grad_LS<CC_t,general_base_iterator<chem_opt> > > C_t;
                   C_t C(CCC,bases,gbenreorderflag);
                   C.max_steps=max_steps;
+                  C.restarts=restarts;
                   C.nruns=tight_steps;
                   cout << "top=gen_base_entropic<gen_base_grad_LS<noprune<chem_opt> > >\n";
                   C.set_id("top");
@@ -643,6 +813,7 @@ int main(int argc, char *argv[])
                   typedef gen_base_entropic<gen_base_LS<CC_t,general_base_iterator<chem_opt> > > C_t;
                   C_t C(CCC,bases);
                   C.max_steps=max_steps;
+                  C.restarts=restarts;
                   C.nruns=tight_steps;
                   cout << "top=gen_base_entropic<gen_base_LS<reorder_general_base<chem_opt> > >\n";
                   C.set_id("top");
@@ -661,6 +832,7 @@ int main(int argc, char *argv[])
                   typedef gen_base_entropic<gen_base_LS<CC_t,general_base_iterator<chem_opt> > > C_t;
                   C_t C(CCC,bases);
                   C.max_steps=max_steps;
+                  C.restarts=restarts;
                   C.nruns=tight_steps;
                   cout << "top=gen_base_entropic<gen_base_LS<noprune<chem_opt> > >\n";
                   C.set_id("top");
@@ -675,6 +847,118 @@ int main(int argc, char *argv[])
                exit(0);
             }
          }
+         else if(method=="ISLAND" ||
+               method=="island") {
+            cout << "Doing island model optimization" << endl;
+            if(max_steps<2) {
+               cout << " Please enter maximum number of computations: ";
+               cin >> max_steps;
+            }
+            if(submethod=="BLS") {
+               if(pruned)
+               {
+                  typedef binary_line_search<simple_prune<has_gradients_data<chem_opt> > > CC_t;
+                  CC_t CC;
+                  (chem_opt&) CC=Complex;
+                  CC.set_number_of_constraints(nconstraints);
+                  refvector<long> bases(CC.get_bits());
+                  for(long i=0;i<bases.size();i++)
+                     bases[i]=2;
+                  typedef island_model<CC_t> C_t;
+                  C_t C(CC,bases);
+                  C.max_steps=max_steps;
+                  C.epochs=tight_steps;
+                  C.islands=islands;
+                  cout << "top=island_model<binary_line_search<simple_prune<has_gradients_data<chem_opt> > > >\n";
+                  C.set_id("top");
+
+                  print<CC_t>(CC);
+                  run<C_t>(C,value,value_passed);
+               }
+               else
+               {
+                  typedef binary_line_search<noprune<has_gradients_data<chem_opt> > > CC_t;
+                  CC_t CC;
+                  (chem_opt&) CC=Complex;
+                  CC.set_number_of_constraints(nconstraints);
+                  refvector<long> bases(CC.get_bits());
+                  for(long i=0;i<bases.size();i++)
+                     bases[i]=2;
+                  typedef island_model<CC_t> C_t;
+                  C_t C(CC,bases);
+                  C.max_steps=max_steps;
+                  C.epochs=tight_steps;
+                  C.islands=islands;
+                  cout << "top=island_model<binary_line_search<noprune<has_gradients_data<chem_opt> > > >\n";
+                  C.set_id("top");
+
+                  print<CC_t>(CC);
+                  run<C_t>(C,value,value_passed);
+               }
+            }
+            else if(submethod=="GBGLS") {
+
+               //Compute the various bases
+               long k=0;
+               for(long i=0; i< Complex.Substituent_Groups_r.size(); i++)
+                  k+=Complex.Substituent_Groups_r[i].allowed_Substituents_r.size();
+               refvector<long> bases(k);
+               k=0;
+               for(long i=0; i< Complex.Substituent_Groups_r.size(); i++)
+                  for(long j=0; j<Complex.Substituent_Groups_r[i].allowed_Substituents_r.size(); j++,k++)
+                  {
+                     bases[k]+=Complex.Substituent_Groups_r[i].allowed_Substituents_r[j].size();
+                     if(bases[k]==0) bases[k]=1;
+                  }
+
+               if(pruned)
+               {
+                  typedef reorder_general_base<chem_opt> CC_t;
+                  CC_t CC(bases);
+                  (chem_opt&) CC=Complex;
+                  CC.set_number_of_constraints(nconstraints);
+                  CC.at_max=at_max_flag;
+                  CC.at_current=at_current_flag;
+                  CC.minimax=minimax_flag;
+                  gen_base_grad_LS<CC_t,general_base_iterator<chem_opt> > CCC(CC);
+                  CCC.precondition_flag=precondition_flag;
+                  typedef island_model<gen_base_grad_LS<CC_t,general_base_iterator<chem_opt> > > C_t;
+                  C_t C(CCC,bases);
+                  C.max_steps=max_steps;
+                  C.epochs=tight_steps;
+                  C.islands=islands;
+                  cout << "top=island_model<gen_base_grad_LS<reorder_general_base<chem_opt> > >\n";
+                  C.set_id("top");
+
+                  print<CC_t> (CC);
+                  run<C_t>(C,value,value_passed);
+               }
+               else
+               {
+                  typedef noprune<chem_opt> CC_t;
+                  CC_t CC;
+                  (chem_opt&) CC=Complex;
+                  CC.minimax = minimax_flag;
+                  CC.set_number_of_constraints(nconstraints);
+                  gen_base_grad_LS<CC_t,general_base_iterator<chem_opt> > CCC(CC);
+                  typedef island_model<gen_base_grad_LS<CC_t,general_base_iterator<chem_opt> > > C_t;
+                  C_t C(CCC,bases);
+                  C.max_steps=max_steps;
+                  C.epochs=tight_steps;
+                  C.islands=islands;
+                  cout << "top=island_model<gen_base_grad_LS<noprune<chem_opt> > >\n";
+                  C.set_id("top");
+
+                  print<CC_t>(CC);
+                  run<C_t>(C,value,value_passed);
+               }
+            }
+            else
+            {
+               cerr << "Please add a submethod\n";
+               exit(0);
+            }
+         }
          else if (method=="GBLS")
          {
             //Compute the various bases
@@ -28,6 +28,8 @@
 
 #include <BCR_CPP_LA/refcount.h>
 #include <Library_data.hh>
+#include <result_cache.hh>
+#include <checkpoint.hh>
 
 using namespace linear_algebra;
 
@@ -41,6 +43,9 @@ Library_data& Library_data::operator=(const Library_data& d)
       bits=d.bits;
       visited=d.visited;
       value=d.value;
+      memo.clear();
+      columns.clear();
+      cache_key_computed=false;
       Name=d.Name;
       return *this;
    } catch(exception& e) {
@@ -54,5 +59,74 @@ void Library_data::set_Name(const string& s) const
 {
    Name=s;
 }
+
+//! Compute cache_key from definition(). Returns false for libraries that are not cached.
+bool Library_data::has_cache_key() const
+{
+   if(!cache_key_computed) {
+      string d=definition();
+      if(d.size()==0) return false;
+      cache_key=result_cache::hash(d);
+      cache_key_computed=true;
+   }
+   return true;
+}
+
+/*!
+   \param val is set to the cached value on success.
+ */
+bool Library_data::cache_lookup(ulong i, valerg& val) const
+{
+   try {
+      if(!result_cache::is_open() || !has_cache_key()) return false;
+      return result_cache::lookup(cache_key,i,val);
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by Library_data::cache_lookup(ulong i, valerg& val) const");
+   }
+}
+
+/*!
+   Callers do not store failed computations, so that they are repeated in
+   later runs.
+ */
+void Library_data::cache_store(ulong i, const valerg& val) const
+{
+   try {
+      if(!result_cache::is_open() || !has_cache_key()) return;
+      result_cache::store(cache_key,i,val);
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by Library_data::cache_store(ulong i, const valerg& val) const");
+   }
+}
+
+/*!
+   A hash of the definition of the library is stored as well, so that a
+   checkpoint is not applied to a different library.
+ */
+void Library_data::save_state(checkpoint& c) const
+{
+   c.put(result_cache::hash(definition()));
+   c.put(visited);
+   c.put(value);
+}
+
+void Library_data::load_state(checkpoint& c) const
+{
+   try {
+      ulong key;
+      c.get(key);
+      if(key!=result_cache::hash(definition()))
+         throw domain_error("The checkpoint belongs to a different library.");
+      c.get(visited);
+      c.get(value);
+      memo.clear();
+      columns.clear();
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by Library_data::load_state(checkpoint& c) const");
+   }
+}
 #endif
 /*! @}*/
@@ -27,21 +27,36 @@
 
 #include <BCR_CPP_LA/refcount.decl>
 #include <typedefs.hh>
+#include <memo_index.hh>
+#include <value_columns.hh>
+#include <vector>
 #include <string>
 
 using namespace linear_algebra;
 using namespace std;
 
+class checkpoint;
+
 //! Abstract class for discrete optimizations.
 class Library_data
 /*!
    The library is considered an access class to a static Library. Therefore,
    Many of its members are mutable since the the static library is too large to
    be stored completely. Instead, entries are computed on the fly and memoized.
+
+   The memo is local to the process and not guarded against concurrent
+   access. Concurrent evaluations run in child processes of eval_pool, which
+   return their values to the parent, and local searches that run in children merge
+   their memos back with merge_memo().
+
+   Scans over all values, such as the Lagrangians of the pruners and the
+   final selection, use the columnar copy of the memo in value_columns
+   through penalty_products(), penalty_product() and best_index().
  */
 {
 private:
    long number_of_constraints;
+
    valerg badval;
    valerg set_badval() const
    {
@@ -50,19 +65,29 @@ private:
       val.property=-INFINITY;
       val.property_computed=false;
       val.energy_computed=false;
-      val.penalty=refvector<double>(number_of_constraints);
+      val.penalty=penalty_vector(number_of_constraints);
       for(long i=0;i<number_of_constraints;i++)
          val.penalty[i]=INFINITY;
       return val;
    }
-protected:
 
+   //! Key of this library in result_cache.
+   mutable ulong cache_key;
+   mutable bool cache_key_computed;
+   bool has_cache_key() const;
+protected:
    //! Visited numbers
    mutable refvector<ulong> visited;
 
    //! Values of visited numbers
    mutable refvector<valerg> value;
 
+   //! Hash index into visited.
+   mutable memo_index memo;
+
+   //! Columnar copy of value.
+   mutable value_columns columns;
+
    mutable ulong space_size;
    mutable bool space_size_computed;
    mutable ulong bits;
@@ -73,6 +98,87 @@ protected:
    //! Class must have a way to compute values.
    virtual valerg compute_property(ulong i) const=0;
 
+   //! Compute the values of several numbers at once.
+   /*!
+      Derived classes override this to dispatch the numbers that have not been
+      visited together. The default computes them one after the other.
+      \return the values in the order of N.
+    */
+   virtual refvector<valerg> compute_properties(const refvector<ulong>& N) const
+   {
+      refvector<valerg> r(N.size());
+      for(long k=0;k<N.size();k++)
+         r[k]=compute_property(N[k]);
+      return r;
+   }
+
+   //! Store the value of number i in the memo.
+   /*!
+      If i has been memoized already, the first value is kept.
+    */
+   void memoize(ulong i, const valerg& val) const
+   {
+      if(memo.find(i,visited)>=0) return;
+      visited.push_back(i);
+      value.push_back(val);
+   }
+
+   //! Remove number i from the memo.
+   void forget(ulong i) const
+   {
+      long j=memo.find(i,visited);
+      if(j<0) return;
+      visited.erase(j);
+      value.erase(j);
+      columns.erase(j);
+   }
+
+   //! Remove all numbers from the memo.
+   void clear_memo() const
+   {
+      visited.clear();
+      value.clear();
+      memo.clear();
+      columns.clear();
+   }
+
+   //! Set the property and, if given, the penalties of number i, memoizing val if i is not visited.
+   void store_property(ulong i, const valerg& val, bool with_penalty) const
+   {
+      long j=memo.find(i,visited);
+      if(j<0) {
+         visited.push_back(i);
+         value.push_back(val);
+         return;
+      }
+      value[j].property=val.property;
+      value[j].property_computed=val.property_computed;
+      if(with_penalty) value[j].penalty=val.penalty;
+      columns.set(j,value[j]);
+   }
+
+   //! Number of memoized values.
+   long memo_size() const
+   {
+      return visited.size();
+   }
+
+   //! Canonical definition of the library for result_cache.
+   /*!
+      Libraries with equal definitions must have equal values for equal numbers.
+      An empty definition (the default) keeps the library out of the cache.
+    */
+   virtual string definition() const { return ""; }
+
+   //! Discard the cache key, to be called whenever definition() changes.
+   void reset_cache_key() const { cache_key_computed=false; }
+
+   //! Look up number i in result_cache. Returns false if it has to be computed.
+   bool cache_lookup(ulong i, valerg& val) const;
+
+   //! Store the value of number i in result_cache.
+   void cache_store(ulong i, const valerg& val) const;
+
    mutable bool compute_property_flag;
 
 public:
@@ -89,8 +195,12 @@ public:
    Library_data():
       number_of_constraints(0),
       badval(set_badval()),
+      cache_key(0),
+      cache_key_computed(false),
       visited(),
       value(),
+      memo(),
+      columns(),
       space_size(0),
       space_size_computed(false),
       bits(0),
@@ -106,8 +216,12 @@ public:
    Library_data(const Library_data& a):
       number_of_constraints(a.number_of_constraints),
       badval(set_badval()),
+      cache_key(0),
+      cache_key_computed(false),
       visited(a.visited),
       value(a.value),
+      memo(),
+      columns(),
       space_size(0),
       space_size_computed(false),
       bits(0),
@@ -138,11 +252,31 @@ public:
    //! Compute the number of bits to address the optimization space.
    virtual ulong get_bits() const=0;
 
+   //! Position of number i in visited_r or -1, found through a hash index.
+   long visited_index(ulong i) const
+   {
+      return memo.find(i,visited);
+   }
+
+   //! Copy the memoized value of number i to val. Returns false if i has not been visited.
+   bool lookup(ulong i, valerg& val) const
+   {
+      long j=memo.find(i,visited);
+      if(j<0) return false;
+      val=value[j];
+      return true;
+   }
+
    //! Retrieve a value for a number.
    valerg get_value(ulong i) const
    {
       return compute_property(i);
    }
+   //! Retrieve the values for a list of numbers.
+   refvector<valerg> get_values(const refvector<ulong>& N) const
+   {
+      return compute_properties(N);
+   }
    const valerg& get_badval() const
    {
       return badval;
@@ -160,6 +294,73 @@ public:
          Bad = Bad || val.penalty[i]==INFINITY;
       return Bad;
    }
+
+   //! \f$\pi_j\cdot\lambda\f$ for the entries j=at[k] of value, in the order of at.
+   /*!
+      Costs O(|at|) rather than O(|value|); the pruners only look at the entries of one run.
+    */
+   void penalty_products(const refvector<double>& lambda, const vector<long>& at, vector<double>& out) const
+   {
+      columns.follow(value);
+      if(columns.uniform() && columns.constraints()==lambda.size()) {
+         columns.products(lambda,at,out);
+         return;
+      }
+      out.resize(at.size());
+      for(unsigned long k=0;k<at.size();k++)
+         out[k]=value[at[k]].penalty*lambda;
+   }
+
+   //! \f$\pi_j\cdot\lambda\f$ for entry j of value.
+   double penalty_product(long j, const refvector<double>& lambda) const
+   {
+      columns.follow(value);
+      if(columns.uniform() && columns.constraints()==lambda.size())
+         return columns.product(j,lambda);
+      return value[j].penalty*lambda;
+   }
+
+   //! Position in visited_r of the compound with the smallest penalty and the largest property.
+   /*!
+      \see value_columns::best()
+    */
+   long best_index() const
+   {
+      columns.follow(value);
+      if(columns.uniform())
+         return columns.best();
+      long b=0;
+      for(long i=0;i<value.size();i++)
+         if(value[i].penalty*value[i].penalty<=value[b].penalty*value[b].penalty)
+            if(!(value[i].penalty==value[b].penalty) || value[i].property > value[b].property)
+               b=i;
+      return b;
+   }
+
+   //! Add the entries of another memo whose numbers have not been visited.
+   /*!
+      Used to collect the values computed by local searches that ran in child
+      processes. The entries are appended in the order of N.
+      \return the number of entries added, which are the last ones of visited_r.
+    */
+   long merge_memo(const refvector<ulong>& N, const refvector<valerg>& V) const
+   {
+      long added=0;
+      for(long k=0;k<N.size() && k<V.size();k++)
+         if(memo.find(N[k],visited)<0) {
+            visited.push_back(N[k]);
+            value.push_back(V[k]);
+            added++;
+         }
+      return added;
+   }
+
+   //! Append the memo to a checkpoint. Derived classes add their own state.
+   virtual void save_state(checkpoint& c) const;
+
+   //! Restore the memo from a checkpoint written by save_state().
+   virtual void load_state(checkpoint& c) const;
+
    //! Sets the name for the purpose of writing files etc.
    void set_Name(const string& A) const;
 
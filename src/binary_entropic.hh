@@ -25,6 +25,8 @@
 #include <cmath>
 #include <BCR_CPP_LA/linear_algebra.h>
 #include <entropic_aux.hh>
+#include <checkpoint.hh>
+#include <local_search_batch.hh>
 
 using namespace std;
 using namespace linear_algebra;
@@ -62,9 +64,11 @@ public:
    ulong nruns;
    //! Maximum number of steps.
    long max_steps;
+   //! Number of runs started at once from mutually distant compounds (--restarts).
+   long restarts;
 
    //! Copy constructor
-   binary_entropic(const C& a) : opt_object(a), nruns(1), max_steps(0)
+   binary_entropic(const C& a) : opt_object(a), nruns(1), max_steps(0), restarts(1)
    {
       refvector<long> b(opt_object.get_bits());
       for(long i=0;i<b.dim();i++)
@@ -72,6 +76,44 @@ public:
       bases=b;
    };
 
+   //! Write the number of completed runs, the next starts and the Library to the checkpoint file, if any.
+   void save_checkpoint(ulong runs, const refvector<ulong>& starts) const
+   {
+      if(checkpoint::get_file()=="") return;
+      checkpoint c;
+      c.put(string("binary_entropic"));
+      c.put(runs);
+      c.put(starts);
+      c.put_random();
+      opt_object.save_state(c);
+      c.write(checkpoint::get_file());
+   }
+
+   //! Restore the state written by save_checkpoint(). Returns false if there is nothing to resume.
+   bool load_checkpoint(ulong& runs, refvector<ulong>& starts) const
+   {
+      string file=checkpoint::take_resume();
+      if(file=="") return false;
+      checkpoint c;
+      c.read(file);
+      c.expect("binary_entropic");
+      c.get(runs);
+      c.get(starts);
+      c.get_random();
+      opt_object.load_state(c);
+      cout << id_r << " Resumed from " << file << " at run " << runs << " with";
+      for(long k=0;k<starts.size();k++)
+         cout << " " << starts[k];
+      cout << endl;
+      return true;
+   }
+
+   //! Run the secondary optimizer from start and return the absolute number found. Called by run_local_searches().
+   ulong local_search(ulong start) const
+   {
+      return opt_object.deprune(opt_object.optimize(start));
+   }
+
    //! Meta-Optimize by generating maximally distant starting configurations.
    ulong optimize(ulong N) const
    /*!
@@ -80,36 +122,37 @@ public:
     */
    {
       try {
-         long i;
          ulong number=N;
-         long config=opt_object.visited_r.contains(N);
+         long config=opt_object.visited_index(N);
 
          // Actual optimization routine.
          ulong conf1;
          conf1=number;
+         ulong first_run=0;
+         refvector<ulong> starts(1);
+         starts[0]=conf1;
+         load_checkpoint(first_run,starts);
 
-         for(ulong runs=0;
-               runs<nruns && max_steps>opt_object.visited_r.size();
-               runs++)
+         ulong runs=first_run;
+         while(runs<nruns && max_steps>opt_object.visited_r.size())
          {
-            conf1=opt_object.optimize(conf1);
-            config=opt_object.visited_r.contains(opt_object.deprune(conf1));
-            print_finished_optimization(config, conf1);
-            // Single optimization run done.
-            conf1=maximize_entropic_distance(opt_object.visited_r,bases);
+            refvector<ulong> found=run_local_searches(*this,opt_object,starts);
+            for(long k=0;k<found.size();k++) {
+               config=opt_object.visited_index(found[k]);
+               if(config<0) continue;
+               conf1=opt_object.reprune(found[k]);
+               print_finished_optimization(config, conf1);
+            }
+            // Batch of optimization runs done.
+            runs+=starts.size();
+            long k=restarts;
+            if(runs<nruns && (long) (nruns-runs)<k) k=nruns-runs;
+            starts=maximize_entropic_distances(opt_object.visited_r,bases,(k>1) ? k : 1);
+            save_checkpoint(runs,starts);
          }
 
          // minimize penalty (assumed to be non-negative), then maximize property
-         conf1=0;
-         for(i=0;i<opt_object.visited_r.size();i++)
-         {
-            if(opt_object.value_r[i].penalty*opt_object.value_r[i].penalty<=
-                  opt_object.value_r[conf1].penalty*opt_object.value_r[conf1].penalty)
-               if(!(opt_object.value_r[i].penalty==opt_object.value_r[conf1].penalty) ||
-                     opt_object.value_r[i].property > opt_object.value_r[conf1].property)
-                  conf1=i;
-         }
-         conf1=opt_object.visited_r[conf1];
+         conf1=opt_object.visited_r[opt_object.best_index()];
          return conf1;
       } catch(exception& e) {
          cerr << e.what() << endl;
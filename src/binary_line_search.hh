@@ -22,6 +22,7 @@
 #define _BINARY_LINE_SEARCH_HH
 
 #include <optimizeabstract.h>
+#include <eval_pool.hh>
 
 using namespace std;
 using namespace linear_algebra;
@@ -42,9 +43,41 @@ protected:
 
    using C::value;
    using C::space_size;
+
+   //! Evaluate the flips of bit i and all higher bits of conf1 in one batch.
+   /*!
+      \param numbers receives the flipped numbers, values their values.
+      \param fresh collects the (deprune'd) numbers which were not in the memo before.
+    */
+   void speculate(ulong conf1, ulong i, refvector<ulong>& numbers, refvector<valerg>& values, refvector<ulong>& fresh) const
+   {
+      ulong j;
+      numbers.clear();
+      for(;i<space_size;)
+      {
+         j=((conf1-conf1 % i)/i)%2;
+         numbers.push_back(conf1-j*i +((j+1) %2)*i);
+         if(i<space_size/2) i*=2;
+         else i=space_size;
+      }
+      refvector<ulong> unseen;
+      for(long k=0;k<numbers.size();k++)
+         if(visited_index(deprune(numbers[k]))<0) unseen.push_back(deprune(numbers[k]));
+      values=C::compute_properties(numbers);
+      for(long k=0;k<unseen.size();k++)
+         if(visited_index(unseen[k])>=0 && fresh.contains(unseen[k])<0)
+            fresh.push_back(unseen[k]);
+   }
 public:
 
+   //! Evaluate all bit flips of the reference at once. Off unless requested with --speculative.
+   bool speculative;
+
+   //! Keep speculative results which the line search did not use in the memo.
+   bool keep_speculative;
+
    using C::visited_r;
+   using C::visited_index;
    using C::compute_property;
    using C::prune;
    using C::deprune;
@@ -53,11 +86,16 @@ public:
    using C::set_number_of_constraints;
 
    //! Default constructor
-   binary_line_search() : optimize_abstract(), C() {};
+   binary_line_search() : optimize_abstract(), C(),
+      speculative(eval_pool::get_speculative()),
+      keep_speculative(eval_pool::get_keep_speculative())
+   {};
 
    //! Copy constructor.
    binary_line_search(const binary_line_search& a) :
-      optimize_abstract(a), C(a)
+      optimize_abstract(a), C(a),
+      speculative(a.speculative),
+      keep_speculative(a.keep_speculative)
    {};
 
    using optimize_abstract::optimize;
@@ -91,6 +129,14 @@ public:
    in the objective function \f$P+\lambda \pi\f$, where P is the property, \f$\pi\f$
    is the penalty and \f$\lambda\f$ is the current value of the Lagrange multiplier,
    then the new molecule becomes the new reference.
+
+   In speculative mode the flips of all remaining bits of the reference are
+   submitted as one batch. They are compared in bit order with the same
+   acceptance rule. Whenever the reference moves, the remaining bits are
+   submitted again for the new reference, hence the trajectory equals the
+   serial one. Speculative results that were never compared are removed from
+   the memo at the end of each sweep unless keep_speculative is set, so that
+   they do not count against budgets on the number of visited compounds.
    \see noprune::adjust_lagrange(), simple_prune::prune(), reorder_general_base::prune()
     */
    ulong optimize(ulong N,refvector<double>& lambda, refvector<ulong>& visited_run) const
@@ -104,10 +150,10 @@ public:
          j=deprune(number);
          if(
                visited_run.contains(j)<0 &&
-               visited_r.contains(j) >= 0
+               visited_index(j) >= 0
          )
             visited_run.push_back(j);
-         long config=visited_r.contains(j);
+         long config=visited_index(j);
          if(lambda.size() != current_best_val.penalty.size()) {
             lambda.copy(value_r[config].penalty);
             lambda.zero();
@@ -122,9 +168,16 @@ public:
 
          valerg interim;
 
+         // Speculative evaluations of the current sweep.
+         refvector<ulong> spec_numbers;
+         refvector<valerg> spec_values;
+         refvector<ulong> spec_fresh;
+         ulong spec_ref=0;
+
          while(conf1!=conf2)
          {
             conf2=conf1;
+            spec_numbers.clear();
             for(i=1;i<space_size;)
             {
                j=((conf1-conf1 % i)/i)%2;
@@ -132,16 +185,26 @@ public:
 
                cout << "In "<< id_r << "::optimize(): " << i << endl;
 
-               interim=compute_property(number);
+               if(speculative) {
+                  if(spec_numbers.size()==0 || spec_ref!=conf1) {
+                     speculate(conf1,i,spec_numbers,spec_values,spec_fresh);
+                     spec_ref=conf1;
+                  }
+                  interim=spec_values[spec_numbers.contains(number)];
+                  long k=spec_fresh.contains(deprune(number));
+                  if(k>=0) spec_fresh.erase(k);
+               }
+               else
+                  interim=compute_property(number);
                j=deprune(number);
                if(
                      visited_run.contains(j)<0 &&
-                     visited_r.contains(j) >= 0
+                     visited_index(j) >= 0
                )
                   visited_run.push_back(j);
                cout << id_r
                      << "::Config: "
-                     << j << "(" << visited_r.contains(j)
+                     << j << "(" << visited_index(j)
                      << ")  finished with property: " << interim.property
                      << " and penalty: ";
                interim.penalty.display();
@@ -150,7 +213,7 @@ public:
                current_best_val.property-lambda*current_best_val.penalty)
                {
                   cout << " > ";
-                  cout << deprune(conf1) << "(" << visited_r.contains(deprune(conf1)) << ") = "
+                  cout << deprune(conf1) << "(" << visited_index(deprune(conf1)) << ") = "
                         << current_best_val.property
                         << " and penalty: ";
                   current_best_val.penalty.display();
@@ -158,11 +221,11 @@ public:
 
                   current_best_val=interim;
                   conf1=number;
-                  config=visited_r.contains(j);
+                  config=visited_index(j);
                }
                else
                {
-                  config=visited_r.contains(deprune(conf1));
+                  config=visited_index(deprune(conf1));
                   cout << " < ";
                   cout << deprune(conf1) << "(" << config << ") = "
                         << current_best_val.property
@@ -175,6 +238,13 @@ public:
                else i=space_size;
             }
 
+            if(!keep_speculative && spec_fresh.size()>0) {
+               for(long k=0;k<spec_fresh.size();k++)
+                  C::forget(spec_fresh[k]);
+               spec_fresh.clear();
+               config=visited_index(deprune(conf1));
+            }
+
             cout << "In " << id_r << "::optimize(): "
                   << " Penalty= ";
             value[config].penalty.display();
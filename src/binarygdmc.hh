@@ -24,6 +24,7 @@
 #include <typedefs.hh>
 #include <iostream>
 #include <optimizeabstract.h>
+#include <checkpoint.hh>
 #include <stdexcept>
 
 using namespace std;
@@ -55,6 +56,43 @@ public:
    //! Copy Constructor.
    binary_gdmc(const C& a) : opt_object(a), T(0.0), tight_steps(1), max_steps(1) {};
 
+   //! Write the loop state and the Library to the checkpoint file, if any.
+   void save_checkpoint(ulong steps, ulong conf1, ulong conf2, ulong conf3, long config, const refvector<double>& lambda) const
+   {
+      if(checkpoint::get_file()=="") return;
+      checkpoint c;
+      c.put(string("binary_gdmc"));
+      c.put(steps);
+      c.put(conf1);
+      c.put(conf2);
+      c.put(conf3);
+      c.put(config);
+      c.put(lambda);
+      c.put_random();
+      opt_object.save_state(c);
+      c.write(checkpoint::get_file());
+   }
+
+   //! Restore the state written by save_checkpoint(). Returns false if there is nothing to resume.
+   bool load_checkpoint(ulong& steps, ulong& conf1, ulong& conf2, ulong& conf3, long& config, refvector<double>& lambda) const
+   {
+      string file=checkpoint::take_resume();
+      if(file=="") return false;
+      checkpoint c;
+      c.read(file);
+      c.expect("binary_gdmc");
+      c.get(steps);
+      c.get(conf1);
+      c.get(conf2);
+      c.get(conf3);
+      c.get(config);
+      c.get(lambda);
+      c.get_random();
+      opt_object.load_state(c);
+      cout << id_r << "::Resumed from " << file << " at step " << steps << " with " << conf1 << endl;
+      return true;
+   }
+
    //! Gradient-directed Monte-Carlo optimization
    ulong optimize(ulong N) const
    /*!
@@ -64,7 +102,7 @@ public:
       try {
          ulong i,j,k;
          ulong number=N;
-         long config=opt_object.visited_r.contains(N);
+         long config=opt_object.visited_index(N);
          refvector<double> lambda(opt_object.get_number_of_constraints());
          ulong steps=1;
 
@@ -78,7 +116,8 @@ public:
 
          refvector<double> grad(valgrad.dim());
 
-         ulong conf3;
+         ulong conf3=conf1;
+         load_checkpoint(steps,conf1,conf2,conf3,config,lambda);
          // tight_steps counts how often lambda is ramped.
          while(tight_steps>=steps)
          {
@@ -121,7 +160,7 @@ public:
                conf1=number;
 
                opt_object.compute_property(conf1);
-               config=opt_object.visited_r.contains(opt_object.deprune(conf1));
+               config=opt_object.visited_index(opt_object.deprune(conf1));
                conf3=conf1;
                conf1=opt_object.deprune(conf1);
 
@@ -136,7 +175,7 @@ public:
                cout.flush();
 
                // Single optimization run done.
-
+               save_checkpoint(steps,conf1,conf2,conf3,config,lambda);
             }
             opt_object.prune(lambda,
                   conf3,
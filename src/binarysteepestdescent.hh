@@ -71,7 +71,7 @@ public:
          ulong i,j,k;
          ulong number=N;
          valerg current_best_val;
-         long config=C::visited.contains(deprune(N));
+         long config=C::visited_index(deprune(N));
          refvector<double> lambda(C::get_number_of_constraints());
 
          current_best_val=compute_property(number);
@@ -124,14 +124,14 @@ public:
                }
 
                conf1=number;
-               config=C::visited.contains(deprune(conf1));
+               config=C::visited_index(deprune(conf1));
                cout << "Config: "
                      << number << "(" << config
                      << ")  finished with property: " << interim.property
                      << " and penalty: ";
                interim.penalty.display();
             }
-            config=C::visited.contains(deprune(conf1));
+            config=C::visited_index(deprune(conf1));
             cout << "The optimized value is: " << C::value[config].property << endl;
             cout << " Penalty: ";
             C::value[config].penalty.display();
@@ -148,7 +148,7 @@ public:
                   conf2,
                   config);
 
-            config=C::visited.contains(deprune(conf1));
+            config=C::visited_index(deprune(conf1));
             lambda*=1.1;
             cout << " New lambda = ";
             lambda.display();
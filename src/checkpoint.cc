@@ -0,0 +1,184 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file checkpoint.cc \brief Implementation of checkpoints.
+
+#include <BCR_CPP_LA/refcount.h>
+#include <checkpoint.hh>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
+
+using namespace std;
+using namespace linear_algebra;
+
+string checkpoint::save_file="";
+string checkpoint::resume_file="";
+
+//! Size of the state of random(). 128 bytes is the default of srandom().
+static const size_t random_state_size=128;
+
+//! State buffer of random() once init_random() was called.
+static char random_state[random_state_size];
+static bool random_state_used=false;
+
+//! Identifies checkpoint files.
+static const string magic="DCCSO checkpoint 1";
+
+void checkpoint::put_raw(const void* p, size_t n)
+{
+   data.append((const char*) p,n);
+}
+
+void checkpoint::get_raw(void* p, size_t n)
+{
+   if(pos+n>data.size())
+      throw domain_error("checkpoint::get_raw(void* p, size_t n): truncated checkpoint");
+   memcpy(p,data.data()+pos,n);
+   pos+=n;
+}
+
+void checkpoint::put(const string& s)
+{
+   put((long) s.size());
+   put_raw(s.data(),s.size());
+}
+
+void checkpoint::get(string& s)
+{
+   long n;
+   get(n);
+   if(n<0 || (size_t) n>data.size()-pos)
+      throw domain_error("checkpoint::get(string& s): corrupt checkpoint");
+   s=data.substr(pos,n);
+   pos+=n;
+}
+
+void checkpoint::put(const valerg& v)
+{
+   put(v.property);
+   put(v.energy);
+   put(v.property_computed);
+   put(v.energy_computed);
+   put(refvector<double>(v.penalty));
+}
+
+void checkpoint::get(valerg& v)
+{
+   get(v.property);
+   get(v.energy);
+   get(v.property_computed);
+   get(v.energy_computed);
+   refvector<double> p;
+   get(p);
+   v.penalty=penalty_vector(p);
+}
+
+void checkpoint::expect(const string& s)
+{
+   string r;
+   get(r);
+   if(r!=s)
+      throw domain_error("checkpoint::expect(const string& s): checkpoint of "+r+" cannot be used for "+s);
+}
+
+/*!
+   The state of the generator used by random() is identical to the one after
+   the same srandom() call without init_random(), so trajectories do not change.
+ */
+void checkpoint::init_random()
+{
+   initstate(1,random_state,random_state_size);
+   random_state_used=true;
+}
+
+/*!
+   setstate() on the active state buffer records the position of the generator
+   in the buffer itself, after which the buffer describes the generator completely.
+ */
+void checkpoint::put_random()
+{
+   if(!random_state_used)
+      throw domain_error("checkpoint::put_random(): init_random() was not called");
+   setstate(random_state);
+   put_raw(random_state,random_state_size);
+}
+
+void checkpoint::get_random()
+{
+   if(!random_state_used)
+      throw domain_error("checkpoint::get_random(): init_random() was not called");
+   get_raw(random_state,random_state_size);
+   setstate(random_state);
+}
+
+/*!
+   The data is written to file.tmp first, which then replaces file.
+ */
+void checkpoint::write(const string& file) const
+{
+   try {
+      string tmp=file+".tmp";
+      {
+         ofstream out(tmp.c_str(),ios::binary);
+         long n=data.size();
+         out << magic << '\n';
+         out.write((const char*) &n,sizeof(n));
+         out.write(data.data(),data.size());
+         out.close();
+         if(!out) throw domain_error("cannot write "+tmp);
+      }
+      if(rename(tmp.c_str(),file.c_str())!=0)
+         throw domain_error("cannot rename "+tmp+" to "+file);
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by checkpoint::write(const string& file) const");
+   }
+}
+
+void checkpoint::read(const string& file)
+{
+   try {
+      ifstream in(file.c_str(),ios::binary);
+      if(!in) throw domain_error("cannot open "+file);
+      string m;
+      getline(in,m);
+      if(m!=magic) throw domain_error(file+" is not a checkpoint");
+      long n;
+      in.read((char*) &n,sizeof(n));
+      if(!in || n<0) throw domain_error(file+" is truncated");
+      data.resize(n);
+      in.read(&data[0],n);
+      if(in.gcount()!=n) throw domain_error(file+" is truncated");
+      pos=0;
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by checkpoint::read(const string& file)");
+   }
+}
+
+string checkpoint::take_resume()
+{
+   string r=resume_file;
+   resume_file="";
+   return r;
+}
@@ -0,0 +1,141 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file checkpoint.hh \brief Binary snapshots of an optimization for restarts.
+
+#ifndef _CHECKPOINT_HH
+#define _CHECKPOINT_HH
+
+#include <BCR_CPP_LA/refcount.decl>
+#include <typedefs.hh>
+#include <string>
+
+using namespace linear_algebra;
+using namespace std;
+
+//! Serialized state of an optimizer stack.
+class checkpoint
+/*!
+   The outer drivers (binary_gdmc, gen_base_gdmc, binary_entropic and
+   gen_base_entropic) write a checkpoint after each run of their secondary
+   optimizer. It holds the loop variables of the driver, the state of the
+   Library stack (memo, pruned numbers, base orders) as written by
+   Library_data::save_state() and its overrides, and the state of random().
+   A run started with the same options and --resume continues the trajectory
+   at the last checkpoint. Values computed after that checkpoint are lost unless
+   a result_cache is used.
+
+   Values are stored in native binary form, hence checkpoints are only meant
+   to be read on the machine that wrote them.
+ */
+{
+private:
+   //! Serialized data.
+   string data;
+
+   //! Read position in data.
+   size_t pos;
+
+   //! File written after each run of the secondary optimizer, empty for none.
+   static string save_file;
+
+   //! File to resume from, empty for none. It is cleared once it has been read.
+   static string resume_file;
+
+   //! Append n raw bytes.
+   void put_raw(const void* p, size_t n);
+
+   //! Read n raw bytes.
+   void get_raw(void* p, size_t n);
+public:
+   //! Empty checkpoint.
+   checkpoint() : data(), pos(0) {};
+
+   //! Checkpoint holding serialized data, e.g., received through a pipe.
+   explicit checkpoint(const string& s) : data(s), pos(0) {};
+
+   //! Serialized data written so far.
+   const string& str() const { return data; }
+
+   //! @name Writing
+   //!@{
+   void put(long x) { put_raw(&x,sizeof(x)); }
+   void put(ulong x) { put_raw(&x,sizeof(x)); }
+   void put(double x) { put_raw(&x,sizeof(x)); }
+   void put(bool x) { char c=x; put_raw(&c,1); }
+   void put(const string& s);
+   void put(const valerg& v);
+   template<class T> void put(const refvector<T>& v)
+   {
+      put((long) v.size());
+      for(long i=0;i<v.size();i++)
+         put(v[i]);
+   }
+   //! Append the state of random().
+   void put_random();
+   //!@}
+
+   //! @name Reading
+   //! The reading methods throw if the checkpoint is truncated.
+   //!@{
+   void get(long& x) { get_raw(&x,sizeof(x)); }
+   void get(ulong& x) { get_raw(&x,sizeof(x)); }
+   void get(double& x) { get_raw(&x,sizeof(x)); }
+   void get(bool& x) { char c; get_raw(&c,1); x=c; }
+   void get(string& s);
+   void get(valerg& v);
+   template<class T> void get(refvector<T>& v)
+   {
+      long n;
+      get(n);
+      if(n<0 || (size_t) n>data.size()-pos)
+         throw domain_error("checkpoint::get(refvector<T>& v): corrupt checkpoint");
+      refvector<T> r(n);
+      for(long i=0;i<n;i++)
+         get(r[i]);
+      v=r;
+   }
+   //! Restore the state of random().
+   void get_random();
+   //! Read a string and throw unless it equals s.
+   void expect(const string& s);
+   //!@}
+
+   //! Write to file. A partially written checkpoint never replaces an older one.
+   void write(const string& file) const;
+
+   //! Read from file.
+   void read(const string& file);
+
+   //! Let random() work on a state that can be saved. Call before seeding.
+   static void init_random();
+
+   //! Write checkpoints to file after each run of the secondary optimizer.
+   static void set_file(const string& file) { save_file=file; }
+
+   //! Return the checkpoint file, empty if checkpoints are not written.
+   static const string& get_file() { return save_file; }
+
+   //! Resume the next outer driver from file.
+   static void set_resume(const string& file) { resume_file=file; }
+
+   //! Return the file to resume from and forget it, empty if there is none.
+   static string take_resume();
+};
+
+#endif
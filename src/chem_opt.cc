@@ -24,6 +24,8 @@
 #include <chem_opt.hh>
 #include <cmath>
 #include <binary_line_search.hh>
+#include <eval_pool.hh>
+#include <synthetic_landscape.hh>
 
 using namespace std;
 using namespace linear_algebra;
@@ -37,6 +39,7 @@ chem_opt& chem_opt::operator=(const ChemGroup& a)
  */
 {
    ChemGroup::operator=(a);
+   reset_cache_key();
    return *this;
 }
 
@@ -68,10 +71,104 @@ void chem_opt::output() const
 valerg chem_opt::compute_property(const ulong i) const
 {
    try {
-      long j=visited.contains(i);
+      valerg val;
+      if(lookup(i,val)) return val;
 
-      if(j>-1) return value[j];
+      if(cache_lookup(i,val)) {
+         memoize(i,val);
+         return val;
+      }
+
+      bool converged;
+      val=conformational_analysis(i,converged);
+      // Molecules without a starting geometry are not memoized.
+      if(!converged) return val;
+
+      memoize(i,val);
+      if(!is_badval(val)) cache_store(i,val);
+      return val;
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("chem_opt::compute_property(const ulong i) const");
+   }
+}
 
+//! Conformational analysis of a molecule as a task for eval_pool.
+class molecule_task : public eval_task
+{
+private:
+   const chem_opt& lib;
+   ulong i;
+public:
+   molecule_task(const chem_opt& a, ulong n) : lib(a), i(n) {};
+
+   valerg evaluate() const
+   {
+      bool converged;
+      return lib.conformational_analysis(i,converged);
+   }
+};
+
+/*!
+   Molecules that have not been visited are submitted to eval_pool at once and
+   memoized afterwards. Molecules without a converged starting geometry are not
+   memoized, just as in compute_property().
+   \return the values in the order of N.
+ */
+refvector<valerg> chem_opt::compute_properties(const refvector<ulong>& N) const
+{
+   try {
+      refvector<ulong> pending;
+      refvector<const eval_task*> tasks;
+      for(long k=0;k<N.size();k++) {
+         if(visited_index(N[k])>=0 || pending.contains(N[k])>=0) continue;
+         valerg val;
+         if(cache_lookup(N[k],val)) {
+            memoize(N[k],val);
+            continue;
+         }
+         pending.push_back(N[k]);
+         tasks.push_back(new molecule_task(*this,N[k]));
+      }
+
+      // Synthetic values are cheaper than a fork and must be counted in this process.
+      refvector<valerg> vals;
+      if(synthetic_landscape::is_active()) {
+         vals=refvector<valerg>(tasks.size());
+         for(long k=0;k<tasks.size();k++)
+            vals[k]=tasks[k]->evaluate();
+      }
+      else
+         vals=eval_pool::run(tasks,get_number_of_constraints());
+      for(long k=0;k<pending.size();k++) {
+         if(!(vals[k]==get_badval())) memoize(pending[k],vals[k]);
+         if(!is_badval(vals[k])) cache_store(pending[k],vals[k]);
+         delete tasks[k];
+      }
+
+      refvector<valerg> r(N.size());
+      for(long k=0;k<N.size();k++)
+         if(!lookup(N[k],r[k])) r[k]=get_badval();
+      return r;
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by chem_opt::compute_properties(const refvector<ulong>& N) const");
+   }
+}
+
+/*!
+   \param converged is set to false if no converged starting geometry was found.
+   In that case the bad value is returned.
+ */
+valerg chem_opt::conformational_analysis(const ulong i, bool& converged) const
+{
+   try {
+      if(synthetic_landscape::is_active()) {
+         converged=true;
+         return synthetic_landscape::evaluate(get_radices(),get_digits(i),get_number_of_constraints());
+      }
+
+      converged=false;
       zmat_connector dummy1,dummy2;
       dummy1.set_opt_val(0,0,false);
       dummy1.set_opt_val(0,1,false);
@@ -79,8 +176,9 @@ valerg chem_opt::compute_property(const ulong i) const
 
       zmat Z;
 
-      occupy(i);
+      // The occupation is passed on rather than set in the ChemIdents, which stay untouched.
       build_zmat(0,
+            get_occupation(i),
             dummy1,
             Z,
             dummy2);
@@ -101,7 +199,6 @@ valerg chem_opt::compute_property(const ulong i) const
       if(!opt_object.pre_opt(0))
       {
          cout << opt_object.id_r << " of " << i << " failed\n";
-         // Added here that we still push this back.
          return get_badval();
       }
 
@@ -109,17 +206,32 @@ valerg chem_opt::compute_property(const ulong i) const
       cout << opt_object.id_r << " of " << i << " done!\n";
       cout.flush();
       opt_object.set_compute_property_flag(true);
-      valerg val=opt_object.compute_property(config);
-
-      visited.push_back(i);
-      value.push_back(val);
-      return val;
+      converged=true;
+      return opt_object.compute_property(config);
    } catch(exception& e) {
       cerr << e.what() << endl;
-      throw domain_error("chem_opt::compute_property(const ulong i) const");
+      throw domain_error("chem_opt::conformational_analysis(const ulong i, bool& converged) const");
    }
 }
 
+/*!
+   The definition covers everything the numbering of molecules depends on,
+   hence it changes when, e.g., the substituents are randomized.
+ */
+string chem_opt::definition() const
+{
+   try {
+      stringstream s;
+      s << "chem_opt property\nconstraints " << get_number_of_constraints() << "\n";
+      if(synthetic_landscape::is_active())
+         s << "synthetic " << synthetic_landscape::get_spec() << "\n";
+      ChemGroup::definition(s);
+      return s.str();
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("chem_opt::definition() const");
+   }
+}
 
 //! Compute the size of the optimization space assuming no constraints.
 ulong chem_opt::get_space_size(const long Group) const
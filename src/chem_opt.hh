@@ -55,6 +55,15 @@ public:
    //! Compute the property.
    valerg compute_property(ulong i) const;
 
+   //! Compute the properties of several molecules concurrently.
+   refvector<valerg> compute_properties(const refvector<ulong>& N) const;
+
+   //! Conformational search and property of molecule i, bypassing the memo.
+   valerg conformational_analysis(ulong i, bool& converged) const;
+
+   //! Canonical definition for the result cache: the groups and the number of constraints.
+   string definition() const;
+
    //! Compute the size of the optimization space.
    ulong get_space_size() const;
 
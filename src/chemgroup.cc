@@ -21,6 +21,7 @@
 #include <BCR_CPP_LA/refcount.h>
 #include <chemgroup.hh>
 #include <zmat.hh>
+#include <flat_zmat.hh>
 #include <string>
 #include <sstream>
 #include <iostream>
@@ -269,6 +270,21 @@ void ChemGroup::output() const
    }
 }
 
+//! Write the complete definition of all groups to out.
+void ChemGroup::definition(ostream& out) const
+{
+   long i;
+   try {
+      for(i=0;i<Substituent_Groups.size();i++) {
+         out << "Group " << i << "\n";
+         Substituent_Groups[i].definition(out);
+      }
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("ChemGroup::definition(ostream& out) const");
+   }
+}
+
 //! Set occupations according to number.
 void ChemGroup::occupy(ulong number) const
 /*!
@@ -295,6 +311,54 @@ void ChemGroup::occupy(ulong number) const
    return;
 }
 
+/*!
+   Unlike occupy(), this leaves the ChemIdents untouched.
+ */
+refvector<refvector<long> > ChemGroup::get_occupation(ulong number) const
+{
+   refvector<refvector<long> > r(Substituent_Groups_r.size());
+   for(long i=0;i< Substituent_Groups_r.size();i++) {
+      const ChemIdent& Group((Substituent_Groups[i]));
+      refvector<long> sites(Group.allowed_Substituents_r.size());
+      for(long j=0;j< Group.allowed_Substituents_r.size();j++) {
+         long groupsize=Group.allowed_Substituents_r[j].size();
+         sites[j]=0;
+         if(groupsize==0) continue;
+         sites[j]=number % groupsize;
+         number/=groupsize;
+      }
+      r[i]=sites;
+   }
+   return r;
+}
+
+/*!
+   Sites without allowed substituents do not contribute to the numbering and are skipped.
+ */
+refvector<long> ChemGroup::get_radices() const
+{
+   refvector<long> r;
+   for(long i=0;i< Substituent_Groups_r.size();i++) {
+      const ChemIdent& Group((Substituent_Groups[i]));
+      for(long j=0;j< Group.allowed_Substituents_r.size();j++)
+         if(Group.allowed_Substituents_r[j].size()>0)
+            r.push_back(Group.allowed_Substituents_r[j].size());
+   }
+   return r;
+}
+
+//! The digits are the indices passed to ChemIdent::occupy() by occupy(number).
+refvector<long> ChemGroup::get_digits(ulong number) const
+{
+   refvector<long> radices=get_radices();
+   refvector<long> d(radices.size());
+   for(long k=0;k<radices.size();k++) {
+      d[k]=number % radices[k];
+      number/=radices[k];
+   }
+   return d;
+}
+
 /*!
   This routine generates the local Z-matrix and combines it with the 
   global Z-matrix for molecule number. Due to connectivity concerns it may be necessary to define 
@@ -369,6 +433,29 @@ zmat& ChemGroup::build_zmat(long Group,
       const zmat_connector& e,
       zmat& A,
       zmat_connector& y) const
+{
+   refvector<refvector<long> > occupation(Substituent_Groups_r.size());
+   for(long i=0;i<Substituent_Groups_r.size();i++)
+      occupation[i]=Substituent_Groups_r[i].occupation_r;
+   return build_zmat(Group,occupation,e,A,y);
+}
+
+/*!
+  Same as build_zmat(long Group, const zmat_connector& e, zmat& A, zmat_connector& y),
+  but the substituent at site i of group g is occupation[g][i].
+
+   \param Group index of the group to be added to the Z-matrix
+   \param occupation occupation of every group, e.g., from get_occupation().
+   \param e defines the connection of Group to the Z-matrix
+   \param A Z-matrix to attach Group topology. It will also be returned. 
+   Note the non-const reference.
+   \param y defines the return connector.
+ */
+zmat& ChemGroup::build_zmat(long Group,
+      const refvector<refvector<long> >& occupation,
+      const zmat_connector& e,
+      zmat& A,
+      zmat_connector& y) const
 {
    if(Group-Substituent_Groups_r.size()<0)
       try {
@@ -387,8 +474,9 @@ zmat& ChemGroup::build_zmat(long Group,
             zmat_connector::update_connector(Substituent_Groups_r[Group].Connector_r[i],e,add,x);
             zmat_connector::update_connector(y,x,0,z);
 
-            M=Substituent_Groups_r[Group].occupation_r[i];
+            M=occupation[Group][i];
             build_zmat(Substituent_Groups_r[Group].allowed_Substituents_r[i][M],
+                  occupation,
                   z,
                   A,
                   y);
@@ -423,14 +511,16 @@ void ChemGroup::enumerate() const
       long i,j;
       space_size=enumerate(0);
       cout << "Space size: " << space_size << endl;
+      // Reused for every molecule.
+      flat_zmat F;
+      string text;
       for(ulong M=0; M<space_size;M++) {
          zmat_connector dummy1,dummy2;
          zmat Z=zmat();
          ulong N=M;
          Z=build_zmat(0,N,dummy1,Z,dummy2);
          cout << "Molecule Number: " << M << "\n";
-         stringstream ss;
-         cout << Z.zmat_to_string(0,ss).str();
+         cout << F.assign(Z).conformation(0,text);
          cout << endl;
       }
    } catch(exception& e) {
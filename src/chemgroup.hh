@@ -83,9 +83,25 @@ public:
          zmat& A,
          zmat_connector& y) const;
 
+   //! Build the Z-matrix using the given occupation of every group, see get_occupation().
+   zmat& build_zmat(long i,
+         const refvector<refvector<long> >& occupation,
+         const zmat_connector& e,
+         zmat& A,
+         zmat_connector& y) const;
+
    //! Set occupations according to number.
    void occupy(ulong number) const;
 
+   //! Occupation of each site of each group for number, as set by occupy(number).
+   refvector<refvector<long> > get_occupation(ulong number) const;
+
+   //! Number of substituents allowed at each site, in the order used by occupy().
+   refvector<long> get_radices() const;
+
+   //! Occupation of each site for number, the mixed-radix digits of number.
+   refvector<long> get_digits(ulong number) const;
+
    /*!
     This double array holds the possible substitutions for each
     substitution site.
@@ -139,6 +155,9 @@ public:
    //! Display to cout what's going on.
    void output() const;
 
+   //! Write the complete definition of all groups to out.
+   void definition(ostream& out) const;
+
    //! Enumerate and print all possible combinations
    void enumerate() const;
 
@@ -440,6 +440,38 @@ void ChemIdent::output() const
   }
 }
 
+/*!
+   Unlike output(), this includes everything that determines the molecules of
+   the library, so that equal definitions describe equal libraries.
+ */
+void ChemIdent::definition(ostream& out) const
+{
+   try {
+      long i,j;
+      stringstream s;
+      out.precision(17);
+      Z_r.output(out);
+      return_connector_r.output(s);
+      out << "ReturnConnector(" << s.str() << ")\nConnector(";
+      for(j=0;j<Connector_r.size();j++) {
+         s.str("");
+         Connector_r[j].output(s);
+         out << s.str() << ";";
+      }
+      out << ")\nallowed_groups(";
+      for(i=0;i<allowed_Substituents_r.size();i++) {
+         out << "(";
+         for(j=0;j<allowed_Substituents_r[i].size();j++)
+            out << allowed_Substituents_r[i][j] << ",";
+         out << ")";
+      }
+      out << ")\n";
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("ChemIdent::definition(ostream& out) const");
+   }
+}
+
 //! Set default occupation of group i to m.
 void ChemIdent::occupy(long i, long m) const
 {
@@ -216,6 +216,9 @@ public:
 
    //! Display to cout what's going on.
    void output() const;
+
+   //! Write the complete definition, including variables and increments, to out.
+   void definition(ostream& out) const;
 };
 #endif
 
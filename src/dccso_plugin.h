@@ -0,0 +1,99 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file dccso_plugin.h \brief C interface of evaluator plugins loaded with --plugin.
+/*!
+   A plugin is a shared library that computes energies and properties in the
+   optimizer's process. It must export dccso_plugin_version(), dccso_energy()
+   and dccso_property(); dccso_init(), dccso_penalty() and dccso_finish() are
+   optional. All functions have C linkage, hence plugins may be written in C.
+
+   Every callback receives a batch of n requests and fills the n results. A
+   request carries the Z-matrix as it would be written to the .zmat file for
+   the external scripts. The result arrays are allocated by the optimizer:
+   penalty holds nconstraints entries, consts and vars hold nconsts and nvars
+   entries. A plugin that optimizes the geometry stores the optimized
+   constants and variables there and sets optimized to 1, taking the place of
+   the .rconsts and .rvars files.
+
+   Build a plugin with, e.g., \verbatim cc -shared -fPIC -o myplugin.so myplugin.c \endverbatim
+ */
+
+#ifndef _DCCSO_PLUGIN_H
+#define _DCCSO_PLUGIN_H
+
+//! Version of this interface. Plugins return it from dccso_plugin_version().
+#define DCCSO_PLUGIN_VERSION 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! One evaluation requested from the plugin.
+typedef struct {
+   //! Identifier of the request, the file prefix used for the external scripts.
+   const char* id;
+   //! Z-matrix in the format of the .zmat files.
+   const char* zmat;
+   //! Number of constants of the Z-matrix.
+   long nconsts;
+   //! Number of variables of the Z-matrix.
+   long nvars;
+} dccso_request;
+
+//! Result of one evaluation, to be filled by the plugin.
+typedef struct {
+   //! 0 on success. The other fields are ignored otherwise. Preset to 0.
+   int status;
+   //! Objective value. Only used for property requests.
+   double property;
+   //! Energy of the final geometry.
+   double energy;
+   //! Penalties of the constraints. Preset to 0 for energies and infinity for properties.
+   double* penalty;
+   //! Optimized constants, nconsts entries.
+   double* consts;
+   //! Optimized variables, nvars entries.
+   double* vars;
+   //! Set to 1 if consts and vars were filled. Preset to 0.
+   int optimized;
+} dccso_result;
+
+//! Must return DCCSO_PLUGIN_VERSION.
+int dccso_plugin_version(void);
+
+//! Optional. Called once after loading with the text following the file name in --plugin. Nonzero aborts.
+int dccso_init(const char* argument);
+
+//! Compute the energies (and geometries) of a batch of conformations.
+void dccso_energy(const dccso_request* request, dccso_result* result, long n);
+
+//! Compute the properties, energies and penalties of a batch of molecules.
+void dccso_property(const dccso_request* request, dccso_result* result, long n);
+
+//! Optional. Called after dccso_property() on the same batch to compute the penalties separately.
+void dccso_penalty(const dccso_request* request, dccso_result* result, long n);
+
+//! Optional. Called before the optimizer exits.
+void dccso_finish(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -22,20 +22,29 @@
 #define _ENTROPIC_AUX_CC_
 #include <iostream>
 #include <cmath>
+#include <vector>
 #include <BCR_CPP_LA/linear_algebra.h>
 #include <entropic_aux.hh>
+#include <memo_index.hh>
 
 using namespace std;
 using namespace linear_algebra;
 
 //! Conjugate gradients for linear solver.
-void linsolve_cg(const mat_sym_full<double>& J,
+/*!
+   Solves the normal equations \f$(J^2+\mu)X=JG\f$, starting from the given X.
+   \return the number of iterations, or -1 if maxiter iterations did not converge.
+ */
+long linsolve_cg(const mat_sym_full<double>& J,
       const refvector<double>& G,
-      refvector<double>& X)
+      refvector<double>& X,
+      long maxiter,
+      double mu)
 {
    // residual
    refvector<double> r(J*G);
    r-=J*(J*X);
+   r-=X*mu;
    // conjugate vector
    refvector<double> c;
    c.copy(r);
@@ -46,22 +55,285 @@ void linsolve_cg(const mat_sym_full<double>& J,
    double a;
    double b;
    double error=1.0;
+   long iterations=0;
    n=r*r;
-   error=(J*c)*(J*c);
+   refvector<double> Ac(J*(J*c));
+   Ac+=c*mu;
+   error=c*Ac;
    while (n > 1e-16 && error > 1e-16)
    {
+      if(iterations>=maxiter) return -1;
+      iterations++;
       a=n/error;
       X+=c*a;
-      r-=(J*(J*c))*a;
+      r-=Ac*a;
       n2=r*r;
       b=n2/n;
       n=n2;
       c*=b;
       c+=r;
-      error=(J*c)*(J*c);
+      Ac=J*(J*c);
+      Ac+=c*mu;
+      error=c*Ac;
+   }
+
+   return iterations;
+}
+
+/*!
+   Factorizes \f$J=LDL^T\f$ in the packed storage of mat_sym_full and solves
+   \f$JX=G\f$. J need not be positive definite, but a pivot smaller than
+   1e-12 times the largest diagonal element counts as singular.
+   \return false if J is numerically singular, X is undefined then.
+ */
+bool linsolve_ldlt(const mat_sym_full<double>& J,
+      const refvector<double>& G,
+      refvector<double>& X)
+{
+   long n=J.cols();
+   double scale=0.0;
+   for(long i=0;i<n;i++)
+      if(fabs(J[i*(i+1)/2+i])>scale) scale=fabs(J[i*(i+1)/2+i]);
+   if(!(scale>0.0)) return false;
+
+   // L (unit diagonal) and D overwrite a copy of J row by row.
+   vector<double> f(n*(n+1)/2);
+   for(long k=0;k<n*(n+1)/2;k++) f[k]=J[k];
+   for(long i=0;i<n;i++) {
+      double* fi=&f[i*(i+1)/2];
+      for(long j=0;j<i;j++) {
+         const double* fj=&f[j*(j+1)/2];
+         double sum=fi[j];
+         for(long k=0;k<j;k++)
+            sum-=fi[k]*fj[k]*f[k*(k+1)/2+k];
+         fi[j]=sum/fj[j];
+      }
+      double d=fi[i];
+      for(long k=0;k<i;k++)
+         d-=fi[k]*fi[k]*f[k*(k+1)/2+k];
+      if(!(fabs(d)>1e-12*scale)) return false;
+      fi[i]=d;
+   }
+
+   if(X.dim()!=n) X.resize(n);
+   vector<double> z(n);
+   for(long i=0;i<n;i++) {
+      double sum=G[i];
+      for(long k=0;k<i;k++)
+         sum-=f[i*(i+1)/2+k]*z[k];
+      z[i]=sum;
+   }
+   for(long i=0;i<n;i++) z[i]/=f[i*(i+1)/2+i];
+   for(long i=n-1;i>=0;i--) {
+      double sum=z[i];
+      for(long k=i+1;k<n;k++)
+         sum-=f[k*(k+1)/2+i]*X[k];
+      X[i]=sum;
    }
+   for(long i=0;i<n;i++)
+      if(!isfinite(X[i])) return false;
+   return true;
+}
 
-   return;
+/*!
+   Uses linsolve_ldlt() and falls back to linsolve_cg() regularized with
+   \f$\mu=10^{-12}\max_i J_{ii}^2\f$ and at most 10n+50 iterations if J is
+   numerically singular. X must be zero on entry.
+ */
+void linsolve_newton(const mat_sym_full<double>& J,
+      const refvector<double>& G,
+      refvector<double>& X,
+      newton_solve_statistics& stats)
+{
+   long n=J.cols();
+   if(linsolve_ldlt(J,G,X))
+      stats.direct++;
+   else {
+      double scale=0.0;
+      for(long i=0;i<n;i++)
+         if(fabs(J[i*(i+1)/2+i])>scale) scale=fabs(J[i*(i+1)/2+i]);
+      X.zero();
+      long iterations=linsolve_cg(J,G,X,10*n+50,1e-12*scale*scale);
+      stats.cg++;
+      if(iterations<0) {
+         stats.cg_unconverged++;
+         stats.cg_iterations+=10*n+50;
+      }
+      else
+         stats.cg_iterations+=iterations;
+   }
+   double g=G*G;
+   if(g>0.0) {
+      refvector<double> r(J*X);
+      r-=G;
+      double residual=sqrt((r*r)/g);
+      if(residual>stats.max_residual) stats.max_residual=residual;
+   }
+}
+
+//! Visited compounds in contiguous storage and the trigonometric terms for a point X.
+class entropic_points
+/*!
+   The gradient, the Hessian and the metric all consist of
+   \f$\sin\f$ and \f$\cos\f$ of \f$(X_j-H_{ij})\pi/b_j\f$ for each compound i and site j.
+   set_point() computes them once per X into rows of length d, so that the
+   derivatives are reductions over contiguous arrays. With OpenMP the loops
+   over compounds run in parallel.
+ */
+{
+public:
+   //! Number of compounds and sites.
+   long n, d;
+   //! \f$\pi/b_j\f$.
+   vector<double> scale;
+   //! Digits of the compounds, n rows of d.
+   vector<double> y;
+   //! Sine and cosine at the last point, n rows of d.
+   vector<double> s, c;
+   //! Inverse of \f$\sum_j\sin^2\f$ per compound, 0 if the point coincides with the compound.
+   vector<double> inverse;
+
+   entropic_points(const refvector<long>& b, const mat_full<double>& H) :
+      n(H.cols()), d(H.rows()), scale(H.rows()), y(H.cols()*H.rows()),
+      s(H.cols()*H.rows()), c(H.cols()*H.rows()), inverse(H.cols())
+   {
+      for(long j=0;j<d;j++) scale[j]=M_PI/(double) b[j];
+      for(long i=0;i<n;i++)
+         for(long j=0;j<d;j++)
+            y[i*d+j]=H[i][j];
+   }
+
+   //! Compute the trigonometric terms at X. Returns false if X coincides with a compound.
+   bool set_point(const refvector<double>& X)
+   {
+      vector<double> x(d);
+      for(long j=0;j<d;j++) x[j]=X[j];
+      long coincide=0;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:coincide)
+#endif
+      for(long i=0;i<n;i++) {
+         double* si=&s[i*d];
+         double* ci=&c[i*d];
+         const double* yi=&y[i*d];
+         double norm=0.0;
+         for(long j=0;j<d;j++) {
+            double t=(x[j]-yi[j])*scale[j];
+            si[j]=sin(t);
+            ci[j]=cos(t);
+            norm+=si[j]*si[j];
+         }
+         if(norm>1e-16)
+            inverse[i]=1.0/norm;
+         else {
+            inverse[i]=0.0;
+            coincide++;
+         }
+      }
+      return coincide==0;
+   }
+
+   //! \f$-\frac12\sum_i\ln(\sum_j\sin^2/d)\f$ at X, the same as dmetric_lnsin().
+   double metric(const refvector<double>& X) const
+   {
+      vector<double> x(d);
+      for(long j=0;j<d;j++) x[j]=X[j];
+      double metric=0.0;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:metric)
+#endif
+      for(long i=0;i<n;i++) {
+         const double* yi=&y[i*d];
+         double sumsin=0.0;
+         for(long j=0;j<d;j++) {
+            double t=sin((x[j]-yi[j])*scale[j]);
+            sumsin+=t*t;
+         }
+         metric-=0.5*log(sumsin/(double) d);
+      }
+      return metric;
+   }
+
+   //! Gradient at the last point. Compounds that coincide with it are skipped.
+   void gradient(refvector<double>& G) const
+   {
+      vector<double> g(d,0.0);
+      double* gp=&g[0];
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:gp[:d])
+#endif
+      for(long i=0;i<n;i++) {
+         const double* si=&s[i*d];
+         const double* ci=&c[i*d];
+         double w=inverse[i];
+         for(long j=0;j<d;j++)
+            gp[j]-=ci[j]*si[j]*w*scale[j];
+      }
+      for(long j=0;j<d;j++) G[j]=g[j];
+   }
+
+   //! Hessian at the last point in packed lower triangular storage.
+   void hessian(mat_sym_full<double>& J) const
+   {
+      long packed=d*(d+1)/2;
+      vector<double> h(packed,0.0);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+      {
+         vector<double> local(packed,0.0);
+         vector<double> a(d);
+#ifdef _OPENMP
+#pragma omp for
+#endif
+         for(long i=0;i<n;i++) {
+            if(inverse[i]==0.0) continue;
+            const double* si=&s[i*d];
+            const double* ci=&c[i*d];
+            double w=inverse[i];
+            for(long j=0;j<d;j++)
+               a[j]=ci[j]*si[j]*w*scale[j];
+            for(long j=0;j<d;j++) {
+               double* row=&local[j*(j+1)/2];
+               double aj=a[j];
+               for(long k=0;k<=j;k++)
+                  row[k]+=aj*a[k];
+               row[j]-=(ci[j]*ci[j]-si[j]*si[j])*w*scale[j]*scale[j]*0.5;
+            }
+         }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+         for(long k=0;k<packed;k++) h[k]+=local[k];
+      }
+      for(long k=0;k<packed;k++) J[k]=2.0*h[k];
+   }
+};
+
+/** Compute the gradient of the distance function \f$ f=\sum_i \ln \sqrt{\sum_j \sin (x_j-s^{(i)}_j\pi/n_j)^2} \f$
+ * where \f$n_j\f$ is the number of digits in component j.
+ */
+static refvector<double>& set_gradient(const entropic_points& P,
+      const refvector<double>& X,
+      bool coincide,
+      refvector<double>& G)
+      //! We ignore infinities in the derivatives
+{
+   if(G.dim()!=P.d)
+      G.resize(P.d);
+   P.gradient(G);
+   if(coincide) {
+      for(long i=0;i<P.n;i++)
+         if(P.inverse[i]==0.0) {
+            cout << "WARNING: set_gradient has encountered a redundancy: ";
+            X.display();
+            cout << " at index H[" << i << "]" << endl;
+         }
+      if(G*G<1e-16)
+         for(long i=0;i<G.dim();i++)
+            G[i]-=1.0;
+   }
+   return G;
 }
 
 /** Compute the gradient of the distance function \f$ f=\sum_i \ln \sqrt{\sum_j \sin (x_j-s^{(i)}_j\pi/n_j)^2} \f$
@@ -79,39 +351,9 @@ refvector<double>& set_gradient(const refvector<long>& b,
                                                                         refvector<double>& G):";
    if(X.dim()!=H.rows())
       throw domain_error(serr+" X and H have incompatible dimensions.");
-   if(G.dim()!=H.rows())
-      G.resize(H.rows());
-   G.zero();
-   long i,j;
-   bool redundancy=false;
-   for(i=0;i<H.cols();i++)
-   {
-      double n=0;
-      for(j=0;j<G.dim();j++)
-         n+=sin((X[j]-H[i][j])*M_PI/(double) b[j])*
-         sin((X[j]-H[i][j])*M_PI/(double) b[j]);
-      if(n>1e-16)
-      {
-         n=(double) 1/n;
-         for(j=0;j<G.dim();j++)
-            G[j]-=(
-                  cos((X[j]-H[i][j])*M_PI/(double) b[j])*
-                  sin((X[j]-H[i][j])*M_PI/(double) b[j])*n*
-                  M_PI/(double) b[j]
-            );
-      }
-      else {
-         redundancy=true;
-         cout << "WARNING: set_gradient has encountered a redundancy: ";
-         X.display();
-         cout << " at index H[" << i << "]" << endl;
-      }
-   }
-
-   if(redundancy && G*G<1e-16)
-      for(i=0;i<G.dim();i++)
-         G[i]-=1.0;
-   return G;
+   entropic_points P(b,H);
+   bool coincide=!P.set_point(X);
+   return set_gradient(P,X,coincide,G);
       }
 
 /** Compute the hessian of the distance function \f$ f=\sum_i \ln \sqrt{\sum_j \sin (x_j-s^{(i)}_j\pi/n_j)^2} \f$
@@ -131,143 +373,102 @@ mat_sym_full<double>& set_hessian(const refvector<long>& b,
       throw domain_error(serr+" X and H have incompatible dimensions.");
    if(J.cols()!=H.rows())
       throw domain_error(serr+" J and H have incompatible dimensions.");
-   J.zero();
-   long i,j,k;
-   for(i=0;i<H.cols();i++)
-   {
-      double n=0;
-      for(j=0;j<H.rows();j++)
-         n+=sin((X[j]-H[i][j])*M_PI/(double) b[j])*
-         sin((X[j]-H[i][j])*M_PI/(double) b[j]);
-      if(n>1e-16)
-      {
-         double n_1;
-         n_1=(double) 1/n;
-         for(j=0;j<J.cols();j++)
-         {
-            for(k=0;k<=j;k++)
-               J[j*(j+1)/2+k]+=(
-                     cos((X[j]-H[i][j])*M_PI/(double) b[j])*
-                     sin((X[j]-H[i][j])*M_PI/(double) b[j])*n_1*
-                     M_PI/(double) b[j]*
-
-                     cos((X[k]-H[i][k])*M_PI/(double) b[k])*
-                     sin((X[k]-H[i][k])*M_PI/(double) b[k])*n_1*
-                     M_PI/(double) b[k]
-               );/*
-               J[j*(j+1)/2+k]-=(
-                                cos((X[j]-H[i][j])*M_PI/(double) b[j])*
-                                sin((X[j]-H[i][j])*M_PI/(double) b[j])*
-                                M_PI/(double) b[j]*
-
-                                cos((X[k]-H[i][k])*M_PI/(double) b[k])*
-                                sin((X[k]-H[i][k])*M_PI/(double) b[k])*
-                                M_PI/(double) b[k]
-                                )*(n_1+(double) 1/((double) b.size()-n));*/
-            J[j*(j+1)/2+j]-=(
-                  cos((X[j]-H[i][j])*M_PI/(double) b[j])*
-                  cos((X[j]-H[i][j])*M_PI/(double) b[j])*n_1*
-                  M_PI/(double) b[j]*M_PI/(double) b[j]
-                                                     -
-                                                     sin((X[j]-H[i][j])*M_PI/(double) b[j])*
-                                                     sin((X[j]-H[i][j])*M_PI/(double) b[j])*n_1*
-                                                     M_PI/(double) b[j]*M_PI/(double) b[j]
-            )*0.5;/*
-            J[j*(j+1)/2+j]-=(
-                             cos((X[j]-H[i][j])*M_PI/(double) b[j])*
-                             cos((X[j]-H[i][j])*M_PI/(double) b[j])*
-                             M_PI/(double) b[j]*M_PI/(double) b[j]
-                             -
-                             sin((X[j]-H[i][j])*M_PI/(double) b[j])*
-                             sin((X[j]-H[i][j])*M_PI/(double) b[j])*
-                             M_PI/(double) b[j]*M_PI/(double) b[j]
-                             )*0.5*(log(n)-log((double) b.size()-n));*/
-         }
-      }
-   }
-   J*=2.0;
+   entropic_points P(b,H);
+   P.set_point(X);
+   P.hessian(J);
    return J;
       }
-//! Create the neighbor if distance 1 around a point X
-refvector<refvector<ulong> > create_neighborhood(const refvector<ulong>& Y, const refvector<long>& bases)
-{
-#ifdef DEBUG
-   if(Y.size() != bases.size())
-      throw domain_error("create_neighborhood: X and bases have differing dimensions");
-#endif
-   refvector<ulong> X(Y);
-   long count=0;
-   for(long dim=0; dim<bases.size();dim++)
-      if(bases[dim]>1) count++;
-   refvector<refvector<ulong> > N(2*count);
-   count=0;
-   for(long dim=0;dim<X.size(); dim++)
-      if(bases[dim]>1) {
-         X[dim]=(X[dim]+1) % bases[dim];
-         N[count].copy(X);
-         count++;
-         if (X[dim]<2) X[dim]=X[dim]-2+bases[dim];
-         else X[dim]=X[dim]-2;
-         N[count].copy(X);
-         X[dim]=(X[dim]+1) % bases[dim];
-         count++;
-      }
-   return N;
-}
-//! Create the neighbor if distance 1 around a point X
-refvector<refvector<ulong> > create_neighborhood(const refvector<refvector<ulong> >& X, const refvector<long> bases)
+//! Set of library numbers, kept as a list with a memo_index.
+class number_set
 {
-   refvector<refvector<ulong> > N;
-   for(long i=0; i<X.size(); i++) {
-      N.concat(create_neighborhood(X[i],bases));
+private:
+   refvector<ulong> list;
+   memo_index index;
+public:
+   //! Whether k is in the set.
+   bool contains(ulong k) { return index.find(k,list)>=0; }
+
+   //! Add k unless it is present. Returns whether it was added.
+   bool insert(ulong k)
+   {
+      if(contains(k)) return false;
+      list.push_back(k);
+      return true;
    }
-   return N;
-}
 
-template <class T>
-refvector<T> without(const refvector<T> &A,
-                     const refvector<T> &B)
-{
-   refvector<T> C;
-   for(long i=0;i<A.size();i++)
-      if(B.contains(A[i])<0)
-         C.push_back(A[i]);
-   return C;
-}
-template <class T>
-refvector<T> Union(const refvector<T> &A,
-                   const refvector<T> &B)
-{
-   refvector<T> C(B);
-   for(long i=0;i<A.size();i++)
-      if(B.contains(A[i])<0)
-         C.push_back(A[i]);
-   return C;
-}
+   //! The numbers in the order of insertion.
+   const refvector<ulong>& numbers() const { return list; }
+};
 
 //! Find a point external to the visited set
 refvector<refvector<ulong> > find_external_point(const refvector<refvector<ulong> >& Gamma, const refvector<long>& bases)
+/*!
+   Breadth-first search from Gamma[0] through visited points until some
+   neighbors (one site changed by +1 or -1, cyclically) have not been visited.
+   Points are handled as their mixed-radix library numbers in hashed sets, and
+   the neighbors of a number are generated from its digits without building
+   the points. The unvisited neighbors of the last layer are returned in the
+   order they are first reached.
+ */
 {
 #ifdef DEBUG
    if(Gamma.size()<1)
       throw domain_error("find_external_point: Gamma is empty");
 #endif
-   refvector<refvector<ulong> > Gamma2;
-   refvector<refvector<ulong> > dGamma;
-   refvector<refvector<ulong> > N;
-   refvector<refvector<ulong> > R;
-   refvector<ulong> X(Gamma[0]);
-   dGamma.push_back(X);
-   N=create_neighborhood(dGamma,bases);
-   R = without(N,Gamma);
-   while(R.size()==0)
+   long d=bases.size();
+   vector<ulong> stride(d);
+   ulong m=1;
+   for(long j=0;j<d;j++) {
+      stride[j]=m;
+      m*=bases[j];
+   }
+
+   number_set visited;
+   for(long i=0;i<Gamma.size();i++) {
+      ulong k=0;
+      for(long j=0;j<d;j++) k+=Gamma[i][j]*stride[j];
+      visited.insert(k);
+   }
+
+   number_set expanded;
+   refvector<ulong> frontier;
+   frontier.push_back(visited.numbers()[0]);
+   refvector<ulong> R;
+   while(frontier.size()>0)
    {
-      Gamma2 = Union(dGamma,Gamma2);
-      dGamma = without(N,Gamma2);
-      N = create_neighborhood(dGamma,bases);
-      R = without(N,Gamma);
+      number_set neighbors;
+      refvector<ulong> next;
+      for(long i=0;i<frontier.size();i++) {
+         ulong k=frontier[i];
+         for(long j=0;j<d;j++) {
+            if(bases[j]<2) continue;
+            ulong digit=(k/stride[j]) % bases[j];
+            ulong up=k-digit*stride[j]+((digit+1) % bases[j])*stride[j];
+            ulong down=k-digit*stride[j]+((digit+bases[j]-1) % bases[j])*stride[j];
+            if(neighbors.insert(up)) next.push_back(up);
+            if(neighbors.insert(down)) next.push_back(down);
+         }
+      }
+      for(long i=0;i<next.size();i++)
+         if(!visited.contains(next[i])) R.push_back(next[i]);
+      if(R.size()>0) break;
+
+      for(long i=0;i<frontier.size();i++)
+         expanded.insert(frontier[i]);
+      frontier.clear();
+      for(long i=0;i<next.size();i++)
+         if(!expanded.contains(next[i])) frontier.push_back(next[i]);
    }
-   return R;
+   if(R.size()==0)
+      throw domain_error("find_external_point: every point has been visited");
+
+   refvector<refvector<ulong> > points(R.size());
+   for(long i=0;i<R.size();i++) {
+      refvector<ulong> x(d);
+      for(long j=0;j<d;j++) x[j]=(R[i]/stride[j]) % bases[j];
+      points[i]=x;
+   }
+   return points;
 }
 
 //! This is the sin metric used \f$m(x,Y) = -0.5\sum_{y\in Y} \ln \sum_{d=1}^{N_d} \sin^2 \frac{\pi(x_d-y_d)}{N_d}/\sum N_d\f$
@@ -317,28 +518,94 @@ long argmin_lnsin(const refvector<refvector<ulong> >& Y, const refvector<refvect
    return minindex;
 }
 
+//! Largest number of sites for which all roundings of x are compared in argmin_lnsin().
+static const long exhaustive_rounding_sites=12;
+
 //! Local search around x
 refvector<ulong> argmin_lnsin(const refvector<refvector<ulong> >& Y, const refvector<double>& x, const refvector<long>& bases)
+/*!
+   Every site may be rounded up or down. For up to exhaustive_rounding_sites
+   sites all \f$2^d\f$ roundings are compared. Beyond that, the rounding to
+   the nearest integers is improved by changing the rounding of the one site
+   that lowers metric_lnsin the most, until no change helps or d^2 changes
+   have been made. Since the metric is a sum over Y of logarithms of
+   sums over the sites, the effect of changing one site is found from the
+   per-compound sums in O(|Y|), hence a step costs O(d|Y|) and the search at
+   most O(d^3|Y|).
+ */
 {
-   refvector<long> xu(bases.dim());
-   refvector<long> xl(bases.dim());
-   mat_full<long> xb(2,bases.dim());
-   for(long i=0; i< bases.dim(); i++) xb[0][i]=(long) ceil(x[i]);
-   for(long i=0; i< bases.dim(); i++) xb[1][i]=(long) floor(x[i]);
-   long ncandidates=(long) pow(2,bases.dim());
-   refvector<refvector<ulong> > candidates(ncandidates);
-   for(long i=0; i<ncandidates; i++)
-   {
-      refvector<ulong> c(bases.dim());
-      long d=i;
-      for(long j=0;j<bases.dim();j++)
+   long nsites=bases.dim();
+   mat_full<long> xb(2,nsites);
+   for(long i=0; i< nsites; i++) xb[0][i]=(long) ceil(x[i]);
+   for(long i=0; i< nsites; i++) xb[1][i]=(long) floor(x[i]);
+   if(nsites<=exhaustive_rounding_sites) {
+      long ncandidates=(long) pow(2,nsites);
+      refvector<refvector<ulong> > candidates(ncandidates);
+      for(long i=0; i<ncandidates; i++)
       {
-         c[j]=((xb[d % 2][j]  % bases[j]) + bases[j]) % bases[j];
-         d=(d-(d%2))/2;
+         refvector<ulong> c(nsites);
+         long d=i;
+         for(long j=0;j<nsites;j++)
+         {
+            c[j]=((xb[d % 2][j]  % bases[j]) + bases[j]) % bases[j];
+            d=(d-(d%2))/2;
+         }
+         candidates[i]=c;
       }
-      candidates[i]=c;
+      return candidates[argmin_lnsin(Y,candidates,bases)];
    }
-   return candidates[argmin_lnsin(Y,candidates,bases)];
+
+   // term[r][j][yi] is the contribution of site j to the sum of compound yi if j is rounded by r.
+   long ny=Y.dim();
+   refvector<long> round(nsites);
+   refvector<refvector<refvector<double> > > term(2);
+   for(long r=0;r<2;r++) {
+      term[r]=refvector<refvector<double> >(nsites);
+      for(long j=0;j<nsites;j++) {
+         term[r][j]=refvector<double>(ny);
+         for(long yi=0;yi<ny;yi++)
+            term[r][j][yi]=pow(sin((double) (xb[r][j]-(long) Y[yi][j])*M_PI/(double) bases[j]),2);
+      }
+   }
+   refvector<double> sumsin(ny);
+   sumsin.zero();
+   for(long j=0;j<nsites;j++) {
+      round[j]=(x[j]-xb[1][j]<0.5) ? 1 : 0;
+      for(long yi=0;yi<ny;yi++)
+         sumsin[yi]+=term[round[j]][j][yi];
+   }
+
+   double current=0.0;
+   for(long yi=0;yi<ny;yi++)
+      current-=0.5*log(sumsin[yi]/(double) nsites);
+   double start=current;
+   long steps=0;
+   for(;steps<nsites*nsites;steps++) {
+      long best=-1;
+      double best_metric=current;
+      for(long j=0;j<nsites;j++) {
+         if(xb[0][j]==xb[1][j]) continue;
+         double metric=0.0;
+         for(long yi=0;yi<ny;yi++)
+            metric-=0.5*log((sumsin[yi]-term[round[j]][j][yi]+term[1-round[j]][j][yi])/(double) nsites);
+         if(metric<best_metric-1e-12) {
+            best_metric=metric;
+            best=j;
+         }
+      }
+      if(best<0) break;
+      for(long yi=0;yi<ny;yi++)
+         sumsin[yi]+=term[1-round[best]][best][yi]-term[round[best]][best][yi];
+      round[best]=1-round[best];
+      current=best_metric;
+   }
+
+   refvector<ulong> c(nsites);
+   for(long j=0;j<nsites;j++)
+      c[j]=((xb[round[j]][j] % bases[j]) + bases[j]) % bases[j];
+   cout << "argmin_lnsin: " << start << " improved to " << metric_lnsin(Y,c,bases)
+         << " in " << steps << " steps" << endl;
+   return c;
 }
 
 //! Maximize the entropic distance as declared in set_gradient() using Newton-Raphson.
@@ -379,19 +646,23 @@ ulong maximize_entropic_distance(const refvector<ulong>& A, const refvector<long
    X.display();
    cout << endl;
 
-   double current_metric=dmetric_lnsin(ulH,X,b);
+   // The trigonometric terms are shared by the gradient and the Hessian of each iteration.
+   entropic_points P(b,H);
+   newton_solve_statistics stats={0,0,0,0,0.0};
+   double current_metric=P.metric(X);
    cout << "Starting metric = " << current_metric << " compared to " << metric_lnsin(ulH,ulX,b) << endl;
    while (error>1e-16)
    {
-      G=set_gradient(b,H,X,G);
-      J=set_hessian(b,H,X,J);
+      bool coincide=!P.set_point(X);
+      G=set_gradient(P,X,coincide,G);
+      P.hessian(J);
       //G-=J*X;
       G*=-1.0;
 
       refvector<double> residual(X.dim());
-      linsolve_cg(J,G,residual);
+      linsolve_newton(J,G,residual,stats);
 
-      while(current_metric+2e-16 < dmetric_lnsin(ulH,X+residual,b))
+      while(current_metric+2e-16 < P.metric(X+residual))
       {
           residual*=0.5;
       }
@@ -399,7 +670,7 @@ ulong maximize_entropic_distance(const refvector<ulong>& A, const refvector<long
       if( error < 2e-16)
       {
           residual = G;
-          while(current_metric+2e-16 < dmetric_lnsin(ulH,X+residual,b))
+          while(current_metric+2e-16 < P.metric(X+residual))
           {
              residual*=0.5;
           }
@@ -407,12 +678,15 @@ ulong maximize_entropic_distance(const refvector<ulong>& A, const refvector<long
       }
       
       X+=residual;
-      current_metric = dmetric_lnsin(ulH,X,b);
+      current_metric = P.metric(X);
       cout << "Current metric = " << current_metric << " ";
       X.display();
       cout << " Gradient "; G.display();
       cout << endl;
    }
+   cout << "Newton steps solved: " << stats.direct << " by LDL^T, " << stats.cg << " by CG in "
+         << stats.cg_iterations << " iterations (" << stats.cg_unconverged << " unconverged), largest relative residual "
+         << stats.max_residual << endl;
    ulong conf1=0;
    ulong m=1;
    for(i=0;i<b.size();i++)
@@ -512,4 +786,34 @@ ulong maximize_entropic_distance(const refvector<ulong>& A, const refvector<long
    cout << "Entropy: " << entropy/(double) b.size() << " Minimum Manhattan distance to set: " << mindist << endl;
    return conf1;
 }
+
+/*!
+   Each point is chosen by maximize_entropic_distance() against A and the
+   points picked before it, so that the batch is spread over the library
+   rather than clustered around the single most distant point. With k=1 the
+   result is that of maximize_entropic_distance(A,b).
+   \return at most k numbers. The batch ends early if the library is exhausted
+   or a point would be picked twice.
+ */
+refvector<ulong> maximize_entropic_distances(const refvector<ulong>& A, const refvector<long>& b, long k)
+{
+   try {
+      refvector<ulong> picked;
+      refvector<ulong> points;
+      points.copy(A);
+      double size=1.0;
+      for(long i=0;i<b.size();i++) size*=b[i];
+      for(long j=0;j<k;j++) {
+         if(j>0 && (double) points.size()>=size) break;
+         ulong conf1=maximize_entropic_distance(points,b);
+         if(j>0 && (picked.contains(conf1)>=0 || A.contains(conf1)>=0)) break;
+         picked.push_back(conf1);
+         points.push_back(conf1);
+      }
+      return picked;
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by maximize_entropic_distances(const refvector<ulong>& A, const refvector<long>& b, long k)");
+   }
+}
 #endif // _ENTROPIC_AUX_CC_
@@ -28,10 +28,35 @@
 using namespace std;
 using namespace linear_algebra;
 
-void linsolve_cg(const mat_sym_full<double>& J,
+//! Counts of the linear solves of the Newton steps in maximize_entropic_distance().
+typedef struct {
+   //! Solves by linsolve_ldlt().
+   long direct;
+   //! Solves that fell back to linsolve_cg().
+   long cg;
+   //! Iterations of all fallback solves.
+   long cg_iterations;
+   //! Fallback solves that reached the iteration limit.
+   long cg_unconverged;
+   //! Largest relative residual \f$|JX-G|/|G|\f$.
+   double max_residual;
+} newton_solve_statistics;
+
+long linsolve_cg(const mat_sym_full<double>& J,
+      const refvector<double>& G,
+      refvector<double>& X,
+      long maxiter,
+      double mu=0.0);
+
+bool linsolve_ldlt(const mat_sym_full<double>& J,
       const refvector<double>& G,
       refvector<double>& X);
 
+void linsolve_newton(const mat_sym_full<double>& J,
+      const refvector<double>& G,
+      refvector<double>& X,
+      newton_solve_statistics& stats);
+
 refvector<double>& set_gradient(const refvector<long>& b,
       const mat_full<double>& H,
       const refvector<double>& X,
@@ -44,4 +69,6 @@ mat_sym_full<double>& set_hessian(const refvector<long>& b,
 
 ulong maximize_entropic_distance(const refvector<ulong>& A, const refvector<long>& b);
 
+refvector<ulong> maximize_entropic_distances(const refvector<ulong>& A, const refvector<long>& b, long k);
+
 #endif // _ENTROPIC_AUX_HH_
@@ -0,0 +1,290 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file eval_pool.cc \brief Implementation of the evaluation pool.
+
+#include <BCR_CPP_LA/refcount.h>
+#include <eval_pool.hh>
+#include <worker_pool.hh>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+using namespace std;
+using namespace linear_algebra;
+
+long eval_pool::jobs=1;
+bool eval_pool::speculative=false;
+bool eval_pool::keep_speculative=false;
+
+//! Value returned for tasks whose child did not report back.
+static valerg failed_value(long nconstraints)
+{
+   valerg val;
+   val.property=-INFINITY;
+   val.energy=INFINITY;
+   val.property_computed=false;
+   val.energy_computed=false;
+   val.penalty=penalty_vector(nconstraints);
+   for(long i=0;i<nconstraints;i++) val.penalty[i]=INFINITY;
+   return val;
+}
+
+//! Serialize a valerg for transfer through a pipe.
+static string encode(const valerg& val)
+{
+   string r;
+   long n=val.penalty.size();
+   char flags[2]={val.property_computed,val.energy_computed};
+   r.append((const char*) &val.property,sizeof(double));
+   r.append((const char*) &val.energy,sizeof(double));
+   r.append(flags,2);
+   r.append((const char*) &n,sizeof(long));
+   for(long i=0;i<n;i++) {
+      double p=val.penalty[i];
+      r.append((const char*) &p,sizeof(double));
+   }
+   return r;
+}
+
+//! Inverse of encode(). Returns false on truncated data.
+static bool decode(const string& s, valerg& val)
+{
+   const size_t head=2*sizeof(double)+2+sizeof(long);
+   if(s.size()<head) return false;
+   long n;
+   const char* p=s.data();
+   memcpy(&val.property,p,sizeof(double));
+   memcpy(&val.energy,p+sizeof(double),sizeof(double));
+   val.property_computed=p[2*sizeof(double)];
+   val.energy_computed=p[2*sizeof(double)+1];
+   memcpy(&n,p+2*sizeof(double)+2,sizeof(long));
+   if(n<0 || s.size()!=head+n*sizeof(double)) return false;
+   val.penalty=penalty_vector(n);
+   for(long i=0;i<n;i++) {
+      double x;
+      memcpy(&x,p+head+i*sizeof(double),sizeof(double));
+      val.penalty[i]=x;
+   }
+   return true;
+}
+
+//! Write all of s to fd.
+static void write_all(int fd, const string& s)
+{
+   size_t done=0;
+   while(done<s.size()) {
+      ssize_t k=write(fd,s.data()+done,s.size()-done);
+      if(k<=0) return;
+      done+=k;
+   }
+}
+
+//! Close the pipes of the still running children and reap them; used when run_jobs() fails.
+static void abandon_children(vector<struct pollfd>& fds, const refvector<long>& task_of, const refvector<long>& pid_of)
+{
+   for(unsigned long k=0;k<fds.size();k++) {
+      if(task_of[k]<0) continue;
+      // A child still writing gets SIGPIPE once its read end is closed.
+      if(fds[k].fd>=0) close(fds[k].fd);
+      fds[k].fd=-1;
+      int status;
+      while(waitpid(pid_of[k],&status,0)<0 && errno==EINTR);
+   }
+}
+
+void eval_pool::set_jobs(long n)
+{
+   jobs=(n<1) ? 1 : n;
+}
+
+//! Adapter running an eval_task as a pool_job.
+class encoded_task : public pool_job
+{
+private:
+   const eval_task* task;
+   long nconstraints;
+public:
+   encoded_task() : task(NULL), nconstraints(0) {};
+   encoded_task(const eval_task* t, long n) : task(t), nconstraints(n) {};
+
+   string run() const
+   {
+      valerg val;
+      try {
+         val=task->evaluate();
+      } catch(exception& e) {
+         // The serial path would throw; here the exception ends only this child.
+         cerr << e.what() << endl;
+         cerr << "eval_pool: evaluation in process " << getpid() << " threw, counted as failed" << endl;
+         val=failed_value(nconstraints);
+      }
+      return encode(val);
+   }
+};
+
+/*!
+   \param tasks the evaluations to be carried out. They are started in the given order.
+   \param nconstraints number of penalties, used for the bad value of failed children.
+   \return the values of the tasks in the order of tasks.
+ */
+refvector<valerg> eval_pool::run(const refvector<const eval_task*>& tasks, long nconstraints)
+{
+   try {
+      long n=tasks.size();
+      refvector<valerg> result(n);
+
+      if(jobs<2 || n<2) {
+         for(long i=0;i<n;i++)
+            result[i]=tasks[i]->evaluate();
+         return result;
+      }
+
+      vector<encoded_task> adapters(n);
+      refvector<const pool_job*> list(n);
+      for(long i=0;i<n;i++) {
+         adapters[i]=encoded_task(tasks[i],nconstraints);
+         list[i]=&adapters[i];
+      }
+      refvector<string> raw=run_jobs(list,1);
+      for(long i=0;i<n;i++)
+         if(!decode(raw[i],result[i])) {
+            cerr << "eval_pool: job " << i << " did not report a result\n";
+            result[i]=failed_value(nconstraints);
+         }
+      return result;
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by eval_pool::run(const refvector<const eval_task*>& tasks, long nconstraints)");
+   }
+}
+
+/*!
+   At most get_jobs()/share children run at the same time. Each of them sees
+   share slots through get_jobs(), and its worker_pool slots follow those of
+   the calling process, so that nested pools never exceed the slots given by
+   --jobs nor share a worker.
+   \param list the jobs to be carried out. They are started in the given order.
+   \param share number of slots given to each child (at least 1).
+   \return the results of the jobs in the order of list, empty for children that failed.
+ */
+refvector<string> eval_pool::run_jobs(const refvector<const pool_job*>& list, long share)
+{
+   try {
+      long n=list.size();
+      refvector<string> result(n);
+      if(n==0) return result;
+      if(share<1) share=1;
+
+      long nslots=jobs/share;
+      if(nslots<1) nslots=1;
+      if(nslots>n) nslots=n;
+      long first_slot=worker_pool::get_slot();
+      // Workers that died in earlier children are restarted here, where they can be reaped.
+      worker_pool::check();
+      refvector<long> task_of(nslots);    // job index per slot, -1 if idle
+      refvector<long> pid_of(nslots);
+      refvector<string> buffer(nslots);
+      vector<struct pollfd> fds(nslots);
+      for(long k=0;k<nslots;k++) {
+         task_of[k]=-1;
+         fds[k].fd=-1;
+         fds[k].events=POLLIN;
+      }
+      long next=0, running=0;
+      while(next<n || running>0)
+      {
+         // Fill idle slots.
+         for(long k=0;k<nslots && next<n;k++) {
+            if(task_of[k]>=0) continue;
+            int p[2];
+            if(pipe(p)!=0) {
+               abandon_children(fds,task_of,pid_of);
+               throw domain_error("pipe() failed");
+            }
+            cout.flush();
+            cerr.flush();
+            pid_t pid=fork();
+            if(pid<0) {
+               close(p[0]);
+               close(p[1]);
+               abandon_children(fds,task_of,pid_of);
+               throw domain_error("fork() failed");
+            }
+            if(pid==0) {
+               close(p[0]);
+               jobs=share;
+               worker_pool::set_slot(first_slot+k*share);
+               string r;
+               try {
+                  r=list[next]->run();
+               } catch(exception& e) {
+                  cerr << e.what() << endl;
+                  cerr << "eval_pool: job " << next << " threw in process " << getpid() << ", no result" << endl;
+                  r="";
+               }
+               write_all(p[1],r);
+               close(p[1]);
+               cout.flush();
+               cerr.flush();
+               _exit(0);
+            }
+            close(p[1]);
+            task_of[k]=next++;
+            pid_of[k]=pid;
+            buffer[k]="";
+            fds[k].fd=p[0];
+            running++;
+         }
+
+         // Collect output of the running children.
+         if(poll(fds.data(),nslots,-1)<0) {
+            if(errno==EINTR) continue;
+            abandon_children(fds,task_of,pid_of);
+            throw domain_error("poll() failed");
+         }
+         for(long k=0;k<nslots;k++) {
+            if(fds[k].fd<0 || !(fds[k].revents & (POLLIN|POLLHUP|POLLERR))) continue;
+            char chunk[4096];
+            ssize_t r=read(fds[k].fd,chunk,sizeof(chunk));
+            if(r>0) {
+               buffer[k].append(chunk,r);
+               continue;
+            }
+            close(fds[k].fd);
+            fds[k].fd=-1;
+            int status;
+            waitpid(pid_of[k],&status,0);
+            result[task_of[k]]=buffer[k];
+            task_of[k]=-1;
+            running--;
+         }
+      }
+      return result;
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by eval_pool::run_jobs(const refvector<const pool_job*>& list, long share)");
+   }
+}
@@ -0,0 +1,111 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file eval_pool.hh \brief Concurrent execution of external evaluations.
+
+#ifndef _EVAL_POOL_HH
+#define _EVAL_POOL_HH
+
+#include <BCR_CPP_LA/refcount.decl>
+#include <typedefs.hh>
+#include <string>
+
+using namespace linear_algebra;
+using namespace std;
+
+//! A single pending evaluation, e.g., the energy of a conformer or the property of a molecule.
+class eval_task
+/*!
+   Derived classes carry everything needed to run one external computation.
+   evaluate() is executed in a child process whenever eval_pool runs more than one
+   job at a time, hence it must not rely on side effects in the calling process.
+ */
+{
+public:
+   virtual ~eval_task() {};
+
+   //! Carry out the computation and return its value.
+   virtual valerg evaluate() const=0;
+};
+
+//! A computation carried out in a child process of eval_pool::run_jobs().
+class pool_job
+/*!
+   The result is returned to the calling process as a byte string. An empty
+   string signals that the child failed.
+ */
+{
+public:
+   virtual ~pool_job() {};
+
+   //! Carry out the computation and return its serialized result.
+   virtual string run() const=0;
+};
+
+//! Runs a list of eval_task objects on a bounded number of worker slots.
+class eval_pool
+/*!
+   Every slot is a forked child process which calls eval_task::evaluate() and
+   returns the resulting valerg through a pipe. The number of slots is set once
+   from the command line (--jobs). With a single slot, tasks are evaluated in
+   order in the calling process, which reproduces the serial behavior exactly.
+   An exception thrown by evaluate() then propagates to the caller; in a child
+   it is reported on standard error and the task gets the bad value.
+
+   Children run their own nested evaluations serially so that the total number
+   of concurrent external jobs never exceeds the number of slots. run_jobs()
+   generalizes this to coarser jobs, e.g., the concurrent local searches of
+   the entropic drivers, which hand a share of the slots to each child.
+ */
+{
+private:
+   //! Number of worker slots.
+   static long jobs;
+
+   //! Whether binary_line_search evaluates all bit flips of its reference at once.
+   static bool speculative;
+
+   //! Whether unused results of speculative evaluations stay in the memo.
+   static bool keep_speculative;
+public:
+   //! Set the number of worker slots (at least 1).
+   static void set_jobs(long n);
+
+   //! Return the number of worker slots.
+   static long get_jobs() { return jobs; }
+
+   //! Choose whether optimizers evaluate speculatively (--speculative).
+   static void set_speculative(bool b) { speculative=b; }
+
+   //! Return whether optimizers evaluate speculatively.
+   static bool get_speculative() { return speculative; }
+
+   //! Choose whether optimizers keep speculative results they did not need.
+   static void set_keep_speculative(bool b) { keep_speculative=b; }
+
+   //! Return whether optimizers keep speculative results they did not need.
+   static bool get_keep_speculative() { return keep_speculative; }
+
+   //! Evaluate all tasks and return their values in the order given.
+   static refvector<valerg> run(const refvector<const eval_task*>& tasks, long nconstraints);
+
+   //! Run every job in a child process with share slots of its own and return the results in the order given.
+   static refvector<string> run_jobs(const refvector<const pool_job*>& list, long share);
+};
+
+#endif
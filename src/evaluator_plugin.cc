@@ -0,0 +1,202 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file evaluator_plugin.cc \brief Implementation of the plugin loader.
+
+#include <BCR_CPP_LA/refcount.h>
+#include <evaluator_plugin.hh>
+#include <dccso_plugin.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <dlfcn.h>
+
+using namespace std;
+using namespace linear_algebra;
+
+void* evaluator_plugin::handle=NULL;
+
+typedef int (*version_function)(void);
+typedef int (*init_function)(const char*);
+typedef void (*batch_function)(const dccso_request*, dccso_result*, long);
+typedef void (*finish_function)(void);
+
+//! Entry points of the loaded library.
+static batch_function energy_function=NULL;
+static batch_function property_function=NULL;
+static batch_function penalty_function=NULL;
+static finish_function finish=NULL;
+
+//! Look up a symbol of the plugin, throwing if a required one is missing.
+static void* symbol(void* handle, const char* name, bool required)
+{
+   void* f=dlsym(handle,name);
+   if(f==NULL && required)
+      throw domain_error(string("The plugin does not provide ")+name);
+   return f;
+}
+
+/*!
+   \param file is passed to dlopen(). Use a path containing a slash for libraries
+   outside the search path of the dynamic linker, e.g., ./myplugin.so.
+   \param argument is passed to dccso_init().
+ */
+void evaluator_plugin::load(const string& file, const string& argument)
+{
+   try {
+      unload();
+      void* h=dlopen(file.c_str(),RTLD_NOW|RTLD_LOCAL);
+      if(h==NULL) throw domain_error(string("dlopen: ")+dlerror());
+      version_function version=(version_function) symbol(h,"dccso_plugin_version",true);
+      if(version()!=DCCSO_PLUGIN_VERSION) {
+         dlclose(h);
+         throw domain_error(file+" was built for a different version of dccso_plugin.h");
+      }
+      energy_function=(batch_function) symbol(h,"dccso_energy",true);
+      property_function=(batch_function) symbol(h,"dccso_property",true);
+      penalty_function=(batch_function) symbol(h,"dccso_penalty",false);
+      finish=(finish_function) symbol(h,"dccso_finish",false);
+      init_function init=(init_function) symbol(h,"dccso_init",false);
+      if(init!=NULL && init(argument.c_str())!=0) {
+         dlclose(h);
+         throw domain_error(file+": dccso_init() failed");
+      }
+      handle=h;
+      atexit(unload);
+      cout << "Evaluator plugin: " << file << endl;
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by evaluator_plugin::load(const string& file, const string& argument)");
+   }
+}
+
+//! True if none of the n numbers is NaN.
+static bool no_nan(const double* x, long n)
+{
+   for(long i=0;i<n;i++)
+      if(isnan(x[i])) return false;
+   return true;
+}
+
+//! A result that reports success still counts as failed if a number is NaN or the requested value is not finite.
+static bool acceptable(bool property, const string& id, const dccso_result& r, long nconstraints, long nconsts, long nvars)
+{
+   bool ok=isfinite(property ? r.property : r.energy) && !isnan(r.property) && !isnan(r.energy)
+      && no_nan(r.penalty,nconstraints) && no_nan(r.consts,nconsts) && no_nan(r.vars,nvars);
+   if(!ok)
+      cerr << "evaluator_plugin: " << (property ? "property" : "energy") << " of " << id << " is not finite, counted as failed" << endl;
+   return ok;
+}
+
+/*!
+   \param kind is energy or property.
+   \param A is the Z-matrix from which the strings in out were generated.
+   \param out Z-matrices of the batch as strings.
+   \param id identifiers of the batch, as the file prefixes used by the scripts.
+   \param nconstraints number of penalties.
+   \param returnA if not NULL, receives a copy of A per request with the optimized geometry if the plugin provided one.
+   \return the values in the order of out.
+ */
+refvector<valerg> evaluator_plugin::evaluate(const string& kind, const zmat& A, const refvector<string>& out,
+      const refvector<string>& id, long nconstraints, refvector<zmat>* returnA)
+{
+   try {
+      long n=out.size();
+      bool property=(kind=="property");
+      long nconsts=A.count_constants();
+      long nvars=A.count_variables();
+
+      vector<dccso_request> request(n);
+      vector<dccso_result> result(n);
+      vector<double> storage(n*(nconstraints+nconsts+nvars));
+      for(long k=0;k<n;k++) {
+         double* p=storage.data()+k*(nconstraints+nconsts+nvars);
+         request[k].id=id[k].c_str();
+         request[k].zmat=out[k].c_str();
+         request[k].nconsts=nconsts;
+         request[k].nvars=nvars;
+         result[k].status=0;
+         result[k].property=-INFINITY;
+         result[k].energy=INFINITY;
+         result[k].penalty=p;
+         result[k].consts=p+nconstraints;
+         result[k].vars=p+nconstraints+nconsts;
+         result[k].optimized=0;
+         for(long i=0;i<nconstraints;i++)
+            p[i]=property ? INFINITY : 0.0;
+      }
+
+      if(n>0) {
+         if(property) {
+            property_function(&request[0],&result[0],n);
+            if(penalty_function!=NULL) penalty_function(&request[0],&result[0],n);
+         }
+         else
+            energy_function(&request[0],&result[0],n);
+      }
+
+      refvector<valerg> r(n);
+      if(returnA!=NULL) *returnA=refvector<zmat>(n);
+      for(long k=0;k<n;k++) {
+         valerg& val=r[k];
+         bool ok=(result[k].status==0) && acceptable(property,id[k],result[k],nconstraints,nconsts,nvars);
+         val.property=(ok && property) ? result[k].property : -INFINITY;
+         val.energy=ok ? result[k].energy : INFINITY;
+         val.property_computed=ok && property;
+         val.energy_computed=ok;
+         val.penalty=penalty_vector(nconstraints);
+         for(long i=0;i<nconstraints;i++)
+            val.penalty[i]=(ok || !property) ? result[k].penalty[i] : INFINITY;
+         if(returnA==NULL) continue;
+         (*returnA)[k]=A;
+         if(ok && result[k].optimized) {
+            refvector<double> consts(nconsts), vars(nvars);
+            for(long i=0;i<nconsts;i++) consts[i]=result[k].consts[i];
+            for(long i=0;i<nvars;i++) vars[i]=result[k].vars[i];
+            (*returnA)[k].set_constants_variables(consts,vars);
+         }
+      }
+      return r;
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by evaluator_plugin::evaluate(const string& kind, const zmat& A, const refvector<string>& out, const refvector<string>& id, long nconstraints, refvector<zmat>* returnA)");
+   }
+}
+
+valerg evaluator_plugin::evaluate(const string& kind, const zmat& A, const string& out, const string& id,
+      zmat& returnA, long nconstraints)
+{
+   refvector<string> outs(1), ids(1);
+   refvector<zmat> geometries;
+   outs[0]=out;
+   ids[0]=id;
+   valerg val=evaluate(kind,A,outs,ids,nconstraints,&geometries)[0];
+   returnA=geometries[0];
+   return val;
+}
+
+void evaluator_plugin::unload()
+{
+   if(handle==NULL) return;
+   if(finish!=NULL) finish();
+   dlclose(handle);
+   handle=NULL;
+}
@@ -0,0 +1,67 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file evaluator_plugin.hh \brief In-process evaluation through a shared library.
+
+#ifndef _EVALUATOR_PLUGIN_HH
+#define _EVALUATOR_PLUGIN_HH
+
+#include <BCR_CPP_LA/refcount.decl>
+#include <typedefs.hh>
+#include <zmat.hh>
+#include <string>
+
+using namespace linear_algebra;
+using namespace std;
+
+//! Evaluator loaded with dlopen() from a shared library (--plugin).
+class evaluator_plugin
+/*!
+   The library implements the C interface of dccso_plugin.h. Once loaded,
+   calc_energy() and calc_property() call the plugin instead of the external
+   scripts, and zmat_opt hands complete batches of conformations to it instead
+   of forking eval_pool tasks.
+
+   The values returned follow calc_energy() and calc_property(): a failed
+   evaluation has an infinite energy, a property of minus infinity and
+   infinite penalties.
+ */
+{
+private:
+   //! Handle returned by dlopen(), NULL if no plugin is loaded.
+   static void* handle;
+public:
+   //! Load the library file and call its dccso_init() with argument.
+   static void load(const string& file, const string& argument);
+
+   //! Whether a plugin is loaded.
+   static bool is_active() { return handle!=NULL; }
+
+   //! Evaluate a batch. kind is energy or property; returnA receives the optimized geometries if not NULL.
+   static refvector<valerg> evaluate(const string& kind, const zmat& A, const refvector<string>& out,
+         const refvector<string>& id, long nconstraints, refvector<zmat>* returnA=NULL);
+
+   //! Evaluate a single Z-matrix, with the arguments of calc_energy() and calc_property().
+   static valerg evaluate(const string& kind, const zmat& A, const string& out, const string& id,
+         zmat& returnA, long nconstraints);
+
+   //! Call dccso_finish() and unload the library.
+   static void unload();
+};
+
+#endif
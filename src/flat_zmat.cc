@@ -0,0 +1,256 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file flat_zmat.cc \brief Contiguous copy of a zmat with interned atom names.
+
+#include <flat_zmat.hh>
+#include <deque>
+#include <map>
+#include <stdexcept>
+#include <charconv>
+
+using namespace std;
+
+//! Names by index. A deque does not move its elements when it grows.
+static deque<string> atom_names_list;
+static map<string,long> atom_names_index;
+
+long atom_names::intern(const string& Name)
+{
+   map<string,long>::const_iterator it=atom_names_index.find(Name);
+   if(it!=atom_names_index.end()) return it->second;
+   long id=atom_names_list.size();
+   atom_names_list.push_back(Name);
+   atom_names_index[Name]=id;
+   return id;
+}
+
+const string& atom_names::name(long id)
+{
+   if(id<0 || id>=(long) atom_names_list.size())
+      throw domain_error("atom_names::name(long id): unknown id");
+   return atom_names_list[id];
+}
+
+/*!
+   Consecutive atoms usually share their name, so the name of the previous
+   row is reused without consulting the table.
+ */
+flat_zmat& flat_zmat::assign(const zmat& A)
+{
+   try {
+      clear();
+      offset=A.offset_r;
+      rows.resize(A.list.size());
+      for(long i=0;i<A.list.size();i++) {
+         const zmat_entry& e=A.list[i];
+         row& r=rows[i];
+         if(i>0 && e.Name_r==A.list[i-1].Name_r)
+            r.name=rows[i-1].name;
+         else
+            r.name=atom_names::intern(e.Name_r);
+         for(long j=0;j<3;j++) {
+            r.connect[j]=e.connect_r[j];
+            r.variable[j]=e.variable_r[j];
+            r.opt_val[j]=e.opt_val_r[j];
+            r.first[j]=pool.size();
+            r.count[j]=e.increment_r[j].size();
+            for(long k=0;k<r.count[j];k++)
+               pool.push_back(e.increment_r[j][k]);
+         }
+      }
+      prepare();
+      return *this;
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by flat_zmat::assign(const zmat& A)");
+   }
+}
+
+zmat& flat_zmat::to_zmat(zmat& A) const
+{
+   try {
+      A=zmat(offset);
+      refvector<double> v(3);
+      refvector<long> c(3);
+      for(long i=0;i<(long) rows.size();i++) {
+         const row& r=rows[i];
+         for(long j=0;j<3;j++) {
+            v[j]=r.variable[j];
+            c[j]=r.connect[j];
+         }
+         A.add_entry(zmat_entry(name(i),v,c));
+         for(long j=0;j<3;j++) {
+            A.set_opt_val(i,j,r.opt_val[j]);
+            for(long k=0;k<r.count[j];k++)
+               A.add_increment(i,j,pool[r.first[j]+k]);
+         }
+      }
+      return A;
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by flat_zmat::to_zmat(zmat& A) const");
+   }
+}
+
+long flat_zmat::count_constants() const
+{
+   long nconstants=0;
+   for_each_written([&](long i, long j) { if(!rows[i].varies(j)) nconstants++; });
+   return nconstants;
+}
+
+long flat_zmat::count_variables() const
+{
+   long nvars=0;
+   for_each_written([&](long i, long j) { if(rows[i].varies(j)) nvars++; });
+   return nvars;
+}
+
+void flat_zmat::set_constants_variables(const refvector<double>& consts,
+      const refvector<double>& vars)
+{
+   long nvars=0;
+   long nconsts=0;
+   for_each_written([&](long i, long j) {
+      if(rows[i].varies(j)) {
+         if(nvars<vars.size())
+            rows[i].variable[j]=vars[nvars];
+         nvars++;
+      }
+      else {
+         if(nconsts<consts.size())
+            rows[i].variable[j]=consts[nconsts];
+         nconsts++;
+      }
+   });
+   if(nconsts>consts.size())
+      cerr << "flat_zmat::set_constants_variables: nconsts discrepancy" << endl;
+   if(nvars>vars.size())
+      cerr << "flat_zmat::set_constants_variables: nvars discrepancy" << endl;
+   prepare();
+}
+
+//! Append the decimal digits of x.
+static void append_chars(string& out, long x)
+{
+   char b[24];
+   to_chars_result r=to_chars(b,b+sizeof(b),x);
+   out.append(b,r.ptr);
+}
+
+//! Append x as iostream does with fixed and precision 2.
+static void append_chars(string& out, double x)
+{
+   // DBL_MAX has 309 digits before the point.
+   char b[320];
+   to_chars_result r=to_chars(b,b+sizeof(b),x,chars_format::fixed,2);
+   out.append(b,r.ptr);
+}
+
+void flat_zmat::prepare()
+{
+   head.clear();
+   tail.clear();
+   dihedrals.clear();
+   long nconstants=0;
+   if(rows.size()>0) {
+      head+=name(0);
+      head+='\n';
+   }
+   for(long i=1;i<(long) rows.size();i++) {
+      const row& r=rows[i];
+      head+=name(i);
+      head+=' ';
+      for(long j=0;j<3 && j<i;j++) {
+         append_chars(head,r.connect[j]+1);
+         if(r.varies(j)) {
+            head+=" dih";
+            append_chars(head,(long) dihedrals.size());
+            dihedral d;
+            d.value=r.variable[j];
+            d.first=r.first[j];
+            d.radix=r.count[j]+1;
+            dihedrals.push_back(d);
+         }
+         else {
+            head+=" c";
+            append_chars(head,nconstants++);
+         }
+         head+=(i==1 ? '\n' : ' ');
+      }
+      if(i>1) head+='\n';
+   }
+   if(dihedrals.size()>0) head+='\n';
+
+   unsigned long stride=1;
+   for(long k=0;k<(long) dihedrals.size();k++) {
+      dihedrals[k].stride=stride;
+      if(dihedrals[k].radix>1)
+         stride=(stride>ULONG_MAX/dihedrals[k].radix ? ULONG_MAX : stride*dihedrals[k].radix);
+   }
+
+   if(nconstants>0) {
+      tail+='\n';
+      long k=0;
+      for_each_written([&](long i, long j) {
+         if(rows[i].varies(j)) return;
+         tail+='c';
+         append_chars(tail,k++);
+         tail+=' ';
+         append_chars(tail,rows[i].variable[j]);
+         tail+='\n';
+      });
+   }
+}
+
+/*!
+   Increment k of a dihedral is digit \f$\lfloor N/s\rfloor \bmod r\f$ of N,
+   with the stride s and radix r of the dihedral, which is what dividing N
+   by the radices one after the other gives. Negative N are decoded in that
+   way.
+
+   \param N signifies the conformation of the combinatorial product of options.
+   \param out buffer to be reused from call to call, so that it does not allocate.
+ */
+string& flat_zmat::conformation(long N, string& out) const
+{
+   out.assign(head);
+   long M=N;
+   for(long k=0;k<(long) dihedrals.size();k++) {
+      const dihedral& d=dihedrals[k];
+      double x=d.value;
+      if(d.radix>1) {
+         long m;
+         if(N>=0)
+            m=((unsigned long) N/d.stride)%d.radix;
+         else {
+            m=M % (long) d.radix;
+            M=(M-m)/(long) d.radix;
+         }
+         if(m>0) x+=pool[d.first+m-1];
+      }
+      out+="dih";
+      append_chars(out,k);
+      out+=' ';
+      append_chars(out,x);
+      out+='\n';
+   }
+   out+=tail;
+   return out;
+}
@@ -0,0 +1,169 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file flat_zmat.hh \brief Contiguous copy of a zmat with interned atom names.
+
+#ifndef _FLAT_ZMAT_HH
+#define _FLAT_ZMAT_HH
+
+#include <zmat.hh>
+#include <string>
+#include <vector>
+#include <climits>
+
+using namespace std;
+using namespace linear_algebra;
+
+//! Table of atom names, shared by all flat_zmat.
+class atom_names
+/*!
+   Every name is stored once and referred to by its index, which stays valid
+   for the whole run.
+ */
+{
+public:
+   //! Index of Name, which is added if it is new.
+   static long intern(const string& Name);
+   //! Name of index id.
+   static const string& name(long id);
+};
+
+//! Z-matrix in a contiguous layout.
+class flat_zmat
+/*!
+   A zmat holds one zmat_entry per atom, each with its own name and its own
+   buffers for connectivity, values, flags and increments. A flat_zmat holds
+   the same information in two arrays: one row per atom with the interned
+   name and fixed arrays of three, and one pool with all increments, which a
+   row refers to by start and length.
+
+   The arrays are kept by clear() and reused by assign(), so a flat_zmat that
+   is refilled for each evaluation works as an arena: after the first
+   molecules, converting a zmat and writing its conformations does not
+   allocate. The zmat itself is still built by ChemGroup::build_zmat().
+   Copies are plain copies of the two arrays.
+
+   The accounting of constants and variables follows the corresponding
+   methods of zmat exactly. Only the values of the dihedrals
+   depend on the conformation, so the atom lines and the constants are
+   written once by assign() and set_constants_variables(), together with the
+   stride of each incremented dihedral in the conformation number.
+   conformation() then appends the dihedrals to a copy of that text, with
+   std::to_chars in place of iostream formatting.
+ */
+{
+public:
+   //! One atom.
+   struct row {
+      //! Index of the name in atom_names.
+      long name;
+      //! Connectivity data
+      long connect[3];
+      //! Values of the variables.
+      double variable[3];
+      //! Optimization flags for each variable.
+      bool opt_val[3];
+      //! Start of the increments of each variable in the pool.
+      long first[3];
+      //! Number of increments of each variable.
+      long count[3];
+
+      //! Whether variable j is a variable of the optimization rather than a constant.
+      bool varies(long j) const { return opt_val[j] || count[j]>0; }
+   };
+
+private:
+   //! A variable of the optimization, as written in the dihedral section.
+   struct dihedral {
+      //! Value without increment.
+      double value;
+      //! Start of the increments in the pool.
+      long first;
+      //! Number of increments plus one; 1 for a variable without increments.
+      unsigned long radix;
+      //! Product of the radices of the preceding dihedrals, saturated at ULONG_MAX.
+      unsigned long stride;
+   };
+
+   vector<row> rows;
+   //! Increments of all rows.
+   vector<double> pool;
+   //! Auxiliary offset, as zmat::offset_r.
+   long offset;
+
+   //! Atom lines, with the blank line that precedes the dihedrals.
+   string head;
+   //! Constant section.
+   string tail;
+   vector<dihedral> dihedrals;
+
+   //! Write head and tail and set up dihedrals.
+   void prepare();
+
+   //! Call f(i,j) for the variables that are written out, in the order of conformation().
+   template<class F> void for_each_written(F f) const
+   {
+      if(rows.size()>1) f(1,0);
+      if(rows.size()>2)
+         for(long j=0;j<2;j++) f(2,j);
+      for(long i=3;i<(long) rows.size();i++)
+         for(long j=0;j<3;j++) f(i,j);
+   }
+
+public:
+   //! @name Constructors
+   //! @{
+
+   //! Empty Z-matrix.
+   flat_zmat() : offset(0) {};
+   //! Copy of A.
+   explicit flat_zmat(const zmat& A) : offset(0) { assign(A); };
+
+   //! @}
+
+   //! Replace the contents by A, reusing the storage.
+   flat_zmat& assign(const zmat& A);
+
+   //! Remove all atoms, keeping the storage.
+   void clear() { rows.clear(); pool.clear(); offset=0; head.clear(); tail.clear(); dihedrals.clear(); }
+
+   //! Copy into a zmat.
+   zmat& to_zmat(zmat& A) const;
+
+   //! Number of atoms.
+   long size() const { return rows.size(); }
+   const row& operator[](long i) const { return rows[i]; }
+   //! Name of atom i.
+   const string& name(long i) const { return atom_names::name(rows[i].name); }
+   //! Increments of variable j of atom i; there are (*this)[i].count[j].
+   const double* increments(long i, long j) const { return pool.data()+rows[i].first[j]; }
+   long offset_r() const { return offset; }
+
+   //! Count the number of constants, as zmat::count_constants().
+   long count_constants() const;
+   //! Count the number of variables, as zmat::count_variables().
+   long count_variables() const;
+   //! Set the constants and variables, as zmat::set_constants_variables().
+   void set_constants_variables(const refvector<double>& consts,
+         const refvector<double>& vars);
+
+   //! Write conformation N of the Z-matrix into out, replacing its contents. This is the text written to id.zmat.
+   string& conformation(long N, string& out) const;
+};
+
+#endif
@@ -27,6 +27,8 @@
 #include <cmath>
 #include <BCR_CPP_LA/linear_algebra.h>
 #include <entropic_aux.hh>
+#include <checkpoint.hh>
+#include <local_search_batch.hh>
 
 using namespace std;
 
@@ -46,17 +48,56 @@ public:
    ulong nruns;
    //! Maximum number of steps.
    long max_steps;
+   //! Number of runs started at once from mutually distant compounds (--restarts).
+   long restarts;
 
    gen_base_entropic(const C& a, const refvector<long>& b, bool _reorder=false) :
-      opt_object(a),bases(b),nruns(2), reorder(_reorder) {};
+      opt_object(a),bases(b),nruns(2), reorder(_reorder), restarts(1) {};
+
+   //! Write the number of completed runs, the next starts and the Library to the checkpoint file, if any.
+   void save_checkpoint(ulong runs, const refvector<ulong>& starts) const
+   {
+      if(checkpoint::get_file()=="") return;
+      checkpoint c;
+      c.put(string("gen_base_entropic"));
+      c.put(runs);
+      c.put(starts);
+      c.put_random();
+      opt_object.save_state(c);
+      c.write(checkpoint::get_file());
+   }
+
+   //! Restore the state written by save_checkpoint(). Returns false if there is nothing to resume.
+   bool load_checkpoint(ulong& runs, refvector<ulong>& starts) const
+   {
+      string file=checkpoint::take_resume();
+      if(file=="") return false;
+      checkpoint c;
+      c.read(file);
+      c.expect("gen_base_entropic");
+      c.get(runs);
+      c.get(starts);
+      c.get_random();
+      opt_object.load_state(c);
+      cout << id_r << " Resumed from " << file << " at run " << runs << " with";
+      for(long k=0;k<starts.size();k++)
+         cout << " " << starts[k];
+      cout << endl;
+      return true;
+   }
+
+   //! Run the secondary optimizer from start. Called by run_local_searches().
+   ulong local_search(ulong start) const
+   {
+      return opt_object.optimize(start);
+   }
 
    //! Meta-Optimize by generating maximally distant starting configurations.
    ulong optimize(ulong N) const
    {
       try {
-         long i;
          ulong number=N;
-         long config=opt_object.lib_object_r.visited_r.contains(N);
+         long config=opt_object.lib_object_r.visited_index(N);
          refvector<double> lambda(opt_object.lib_object_r.get_number_of_constraints());
 
          opt_object.set_id(id_r+"::opt_object");
@@ -64,19 +105,27 @@ public:
          // Actual optimization routine.
          ulong conf1;
          conf1=number;
+         ulong first_run=0;
+         refvector<ulong> starts(1);
+         starts[0]=conf1;
+         load_checkpoint(first_run,starts);
 
-         for(ulong runs=0;
-               runs<nruns && max_steps>opt_object.lib_object_r.visited_r.size();
-               runs++)
+         ulong runs=first_run;
+         while(runs<nruns && max_steps>opt_object.lib_object_r.visited_r.size())
          {
-            cout << id_r << " Starting run " << runs << " with " << conf1 << endl;
-            conf1=opt_object.optimize(conf1);
-            config=opt_object.lib_object_r.visited_r.contains(conf1);
-            cout << id_r << ":The optimized value in run " << runs << " is: " << opt_object.lib_object_r.value_r[config].property;
-            cout << " Penalty: ";
-            opt_object.lib_object_r.value_r[config].penalty.display();
-            cout << id_r << " for compound #" << conf1 << endl;
-            cout.flush();
+            for(long k=0;k<starts.size();k++)
+               cout << id_r << " Starting run " << runs+k << " with " << starts[k] << endl;
+            refvector<ulong> found=run_local_searches(*this,opt_object.lib_object_r,starts);
+            for(long k=0;k<found.size();k++) {
+               conf1=found[k];
+               config=opt_object.lib_object_r.visited_index(conf1);
+               if(config<0) continue;
+               cout << id_r << ":The optimized value in run " << runs+k << " is: " << opt_object.lib_object_r.value_r[config].property;
+               cout << " Penalty: ";
+               opt_object.lib_object_r.value_r[config].penalty.display();
+               cout << id_r << " for compound #" << conf1 << endl;
+               cout.flush();
+            }
 
             refvector<ulong> library(opt_object.lib_object_r.visited_r.size());
             if (reorder)
@@ -84,10 +133,15 @@ public:
                   library[i]=opt_object.lib_object_r.reprune(opt_object.lib_object_r.visited_r[i]);
             else
                library=opt_object.lib_object_r.visited_r;
-            // Single optimization run done.
-            conf1=maximize_entropic_distance(library,bases);
+            // Batch of optimization runs done.
+            runs+=starts.size();
+            long k=restarts;
+            if(runs<nruns && (long) (nruns-runs)<k) k=nruns-runs;
+            starts=maximize_entropic_distances(library,bases,(k>1) ? k : 1);
             if (reorder)
-               conf1=opt_object.lib_object_r.deprune(conf1);
+               for(long i=0;i<starts.size();i++)
+                  starts[i]=opt_object.lib_object_r.deprune(starts[i]);
+            save_checkpoint(runs,starts);
          }
          cout << id_r << " Total Visited configurations ";
          opt_object.lib_object_r.visited_r.display();
@@ -95,16 +149,7 @@ public:
          cout << id_r << "Number of configurations: " << opt_object.lib_object_r.visited_r.dim() << endl;
 
 
-         conf1=0;
-         for(i=0;i<opt_object.lib_object_r.visited_r.size();i++)
-         {
-            if(opt_object.lib_object_r.value_r[i].penalty*opt_object.lib_object_r.value_r[i].penalty<=
-                  opt_object.lib_object_r.value_r[conf1].penalty*opt_object.lib_object_r.value_r[conf1].penalty)
-               if(!(opt_object.lib_object_r.value_r[i].penalty==opt_object.lib_object_r.value_r[conf1].penalty) ||
-                     opt_object.lib_object_r.value_r[i].property > opt_object.lib_object_r.value_r[conf1].property)
-                  conf1=i;
-         }
-         conf1=opt_object.lib_object_r.visited_r[conf1];
+         conf1=opt_object.lib_object_r.visited_r[opt_object.lib_object_r.best_index()];
          return conf1;
       } catch(exception& e) {
          cerr << e.what() << endl;
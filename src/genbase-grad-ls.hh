@@ -24,6 +24,7 @@
 #include <typedefs.hh>
 #include <iostream>
 #include <optimizeabstract.h>
+#include <checkpoint.hh>
 #include <BCR_CPP_LA/refcount.h>
 
 using namespace std;
@@ -43,18 +44,20 @@ private:
    {
       long j;
       long nm;
-      valerg interim;
       for(bases=0;!bases.done();bases++)
       {
          cout << "In "<< id_r << "::precondition() " << bases.get_state() << endl;
 
          ulong conf3=conf1-(((conf1-conf1%bases())/bases()) % bases.modulus()) * bases();
 
+         // The whole direction is submitted at once.
+         refvector<ulong> N(bases.modulus());
+         for(j=0;j<bases.modulus();j++)
+            N[j]=conf3+j*bases();
+         refvector<valerg> interims=lib_object.compute_properties(N);
          for(j=0;j<bases.modulus();j++)
          {
-            nm=conf3+j*bases();
-            interim=lib_object.compute_property(nm);
-            update_visited_run(visited_run, nm, interim);
+            update_visited_run(visited_run, N[j], interims[j]);
             cout << endl;
          }
       }
@@ -78,14 +81,14 @@ private:
       if ((interim.property_computed && interim.property - lambda * interim.penalty > current_best_val.property - lambda * current_best_val.penalty) ||
           lib_object_r.is_badval(current_best_val) ) {
          cout << " > ";
-         cout << lib_object.deprune(conf1) << "(" << lib_object.visited_r.contains(lib_object.deprune(conf1)) << ") = " << current_best_val.property << " and penalty: ";
+         cout << lib_object.deprune(conf1) << "(" << lib_object.visited_index(lib_object.deprune(conf1)) << ") = " << current_best_val.property << " and penalty: ";
          current_best_val.penalty.display();
          cout << endl;
          conf1 = np;
          current_best_val = interim;
-         config = lib_object.visited_r.contains(lib_object.deprune(conf1));
+         config = lib_object.visited_index(lib_object.deprune(conf1));
       } else {
-         config = lib_object.visited_r.contains(lib_object.deprune(conf1));
+         config = lib_object.visited_index(lib_object.deprune(conf1));
          cout << " <= ";
          cout << lib_object.deprune(conf1) << "(" << config << ") = " << current_best_val.property << " and penalty: ";
          current_best_val.penalty.display();
@@ -98,7 +101,7 @@ private:
       if (visited_run.contains(lib_object.deprune(np)) < 0)
          visited_run.push_back(lib_object.deprune(np));
 
-      cout << id_r << "::Config: " << lib_object.deprune(np) << "(" << lib_object.visited_r.contains(lib_object.deprune(np)) << ")  finished with property: " << interim.property << " and penalty: ";
+      cout << id_r << "::Config: " << lib_object.deprune(np) << "(" << lib_object.visited_index(lib_object.deprune(np)) << ")  finished with property: " << interim.property << " and penalty: ";
       interim.penalty.display();
    }
 
@@ -119,10 +122,15 @@ private:
          cout << "In " << id_r << "::optimize(): " << bases.get_state() << endl;
          np = conf1 + (-j + (j + 1) % bases.modulus()) * bases();
          nm = conf1 + (-j + (j + bases.modulus() - 1) % bases.modulus()) * bases();
-         interimp = lib_object.compute_property(np);
+         // Both neighbors are evaluated together; they are compared in the serial order.
+         refvector<ulong> N(2);
+         N[0] = np;
+         N[1] = nm;
+         refvector<valerg> interims = lib_object.compute_properties(N);
+         interimp = interims[0];
+         interimm = interims[1];
          update_visited_run(visited_run, np, interimp);
          select_current_best(interimp, lambda, current_best_val, conf1, np, config);
-         interimm = lib_object.compute_property(nm);
          update_visited_run(visited_run, nm, interimm);
          select_current_best(interimm, lambda, current_best_val, conf1, nm, config);
          refvector<double> l=(interimp.penalty-interimm.penalty);
@@ -180,16 +188,21 @@ public:
       ulong np;
       ulong nm;
 
-      for(bases=0,i=0;!bases.done();bases++,i++)
+      // Collect all neighbors first and evaluate them in one batch.
+      refvector<ulong> N;
+      for(bases=0;!bases.done();bases++)
       {
          j=((conf1 - conf1 % bases())/bases()) % bases.modulus();
 
          np=conf1+(-j+(j+1) % bases.modulus())*bases();
          nm=conf1+(-j+(j+bases.modulus()-1) % bases.modulus())*bases();
 
-         r[i]=lib_object.compute_property(np);
-         r[i]-=lib_object.compute_property(nm);
+         N.push_back(np);
+         N.push_back(nm);
       }
+      refvector<valerg> interims=lib_object.compute_properties(N);
+      for(i=0;2*i<N.size();i++)
+         r[i]=interims[2*i]-interims[2*i+1];
       bases.set_refstate(saved_refstate);
       bases=saved_state;
       return r;
@@ -208,16 +221,29 @@ public:
    more rigorously.
     */
    ulong optimize(ulong N) const
+   {
+      refvector<double> lambda;
+      refvector<ulong> visited_run;
+      return optimize(N,lambda,visited_run);
+   }
+
+   //! Optimize starting from conformation N with the Lagrange multipliers lambda.
+   /*!
+      lambda is set to zero unless it has one entry per constraint, and holds
+      the final multipliers on return. The compounds of the run are appended to
+      visited_run. This is the interface of binary_line_search, used by island_model.
+    */
+   ulong optimize(ulong N, refvector<double>& lambda, refvector<ulong>& visited_run) const
    {
       try
       {
          ulong number=lib_object_r.reprune(N);
          valerg current_best_val;
-         long config=lib_object.visited_r.contains(N);
-         refvector<ulong> visited_run;
+         long config=lib_object.visited_index(N);
 
          current_best_val=lib_object.compute_property(number);
-         visited_run.push_back(lib_object.deprune(number));
+         if(visited_run.contains(lib_object.deprune(number))<0)
+            visited_run.push_back(lib_object.deprune(number));
          while(lib_object_r.is_badval(current_best_val) && number<lib_object_r.get_space_size()-1)
          {
             number++;
@@ -229,7 +255,10 @@ public:
          
          if(precondition_flag)
             precondition(number,visited_run);
-         refvector<double> lambda(lib_object_r.get_number_of_constraints());
+         if(lambda.size()!=lib_object_r.get_number_of_constraints()) {
+            lambda=refvector<double>(lib_object_r.get_number_of_constraints());
+            lambda.zero();
+         }
 
          // Actual optimization routine.
          ulong conf1;
@@ -251,7 +280,7 @@ public:
                bases.set_refstate(lib_object.deprune(conf1));
             }
 
-            config=lib_object.visited_r.contains(lib_object.deprune(conf1));
+            config=lib_object.visited_index(lib_object.deprune(conf1));
             {
                cout << id_r+"::optimized value in cycle " << cycle << " is: " << lib_object.value_r[config].property;
                cout << " Penalty: ";
@@ -287,7 +316,7 @@ public:
       catch (domain_error e)
       {
          cerr << e.what() << endl;
-         throw domain_error("called by gen_base_grad_LS::optimize(ulong N) const");
+         throw domain_error("called by gen_base_grad_LS::optimize(ulong N, refvector<double>& lambda, refvector<ulong>& visited_run) const");
       }
    }
 
@@ -295,6 +324,12 @@ public:
    {
       return lib_object.get_value(i);
    }
+
+   //! Append the state of the Library to a checkpoint.
+   void save_state(checkpoint& c) const { lib_object.save_state(c); }
+
+   //! Restore the state of the Library from a checkpoint.
+   void load_state(checkpoint& c) const { lib_object.load_state(c); }
    void set_compute_property_flag(bool Bo) const {lib_object.set_compute_property_flag(Bo);}
 protected:
 
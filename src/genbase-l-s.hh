@@ -24,6 +24,7 @@
 #include <typedefs.hh>
 #include <iostream>
 #include <optimizeabstract.h>
+#include <checkpoint.hh>
 #include <BCR_CPP_LA/refcount.h>
 
 using namespace std;
@@ -43,14 +44,14 @@ class gen_base_LS: public optimize_abstract
    {
       if (interim.property_computed && interim.property - lambda * interim.penalty >= current_best_val.property - lambda * current_best_val.penalty) {
          cout << " > ";
-         cout << lib_object.deprune(conf1) << "(" << lib_object.visited_r.contains(lib_object.deprune(conf1)) << ") = " << current_best_val.property << " and penalty: ";
+         cout << lib_object.deprune(conf1) << "(" << lib_object.visited_index(lib_object.deprune(conf1)) << ") = " << current_best_val.property << " and penalty: ";
          current_best_val.penalty.display();
 
          current_best_val = interim;
          conf1 = nm;
-         config = lib_object.visited_r.contains(lib_object.deprune(conf1));
+         config = lib_object.visited_index(lib_object.deprune(conf1));
       } else {
-         config = lib_object.visited_r.contains(lib_object.deprune(conf1));
+         config = lib_object.visited_index(lib_object.deprune(conf1));
          cout << " < ";
          cout << lib_object.deprune(conf1) << "(" << config << ") = " << current_best_val.property << " and penalty: ";
          current_best_val.penalty.display();
@@ -62,7 +63,7 @@ class gen_base_LS: public optimize_abstract
       if (interim.property_computed && visited_run.contains(lib_object.deprune(nm)) < 0)
          visited_run.push_back(lib_object.deprune(nm));
 
-      cout << id_r << "::Config: " << lib_object.deprune(nm) << "(" << lib_object.visited_r.contains(lib_object.deprune(nm)) << ")  finished with property: " << interim.property << " and penalty: ";
+      cout << id_r << "::Config: " << lib_object.deprune(nm) << "(" << lib_object.visited_index(lib_object.deprune(nm)) << ")  finished with property: " << interim.property << " and penalty: ";
       interim.penalty.display();
    }
 
@@ -91,7 +92,7 @@ public:
          ulong number=lib_object_r.reprune(N);
          valerg current_best_val;
          refvector<ulong> visited_run;
-         long config=lib_object.visited_r.contains(N);
+         long config=lib_object.visited_index(N);
 
          current_best_val=lib_object.compute_property(number);
          while(current_best_val.energy==INFINITY && number<lib_object_r.get_space_size()-1)
@@ -134,7 +135,7 @@ public:
                bases.set_refstate(conf1);
             }
 
-            config=lib_object.visited_r.contains(lib_object.deprune(conf1));
+            config=lib_object.visited_index(lib_object.deprune(conf1));
             cout << id_r+"::optimized value is: " << lib_object.value_r[config].property;
             cout << " Penalty: ";
             lib_object.value_r[config].penalty.display();
@@ -171,6 +172,12 @@ public:
    {
       return lib_object.get_value(i);
    }
+
+   //! Append the state of the Library to a checkpoint.
+   void save_state(checkpoint& c) const { lib_object.save_state(c); }
+
+   //! Restore the state of the Library from a checkpoint.
+   void load_state(checkpoint& c) const { lib_object.load_state(c); }
    void set_compute_property_flag(bool Bo) const {lib_object.set_compute_property_flag(Bo);}
 protected:
 
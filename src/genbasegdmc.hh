@@ -23,8 +23,14 @@
 
 #include <typedefs.hh>
 #include <iostream>
+#include <sstream>
 #include <optimizeabstract.h>
+#include <checkpoint.hh>
+#include <eval_pool.hh>
+#include <local_search_batch.hh>
 #include <BCR_CPP_LA/refcount.h>
+#include <cmath>
+#include <vector>
 
 using namespace std;
 
@@ -36,6 +42,21 @@ class gen_base_gdmc: public optimize_abstract
    a vertex on the hull of the torus. After a local optimum has been reached, a
    Monte-Carlo simulation is performed to determine a new starting point.
    Each time a new minimum is found the acceptance criteria become more strict.
+
+   With more than one replica, chains at the temperatures T, T*ladder, T*ladder^2, ...
+   perform these steps at once (see eval_pool::run_jobs()) and their values
+   are merged into the memo after each step. Neighbouring chains then exchange
+   their starting points with the parallel tempering acceptance probability
+   \f$\min(1,\exp((f_j-f_i)(1/T_i-1/T_j)))\f$, where f is \f$P-\lambda \pi\f$
+   of the local optima found. Each chain draws from a random stream of its own,
+   seeded from random(), so that runs are reproducible.
+
+   The chains do not share one memo while they run. Every chain runs in a
+   child process from the state at the beginning of the round and sees the
+   values of the other chains only after the round, when they are merged
+   into the memo; the rest of its state, e.g., base_order and the pruned
+   numbers of reorder_general_base, is lost with the child. This holds for
+   any number of --jobs, so the trajectories do not depend on it.
  */
 {
 
@@ -45,6 +66,276 @@ private:
    //! Definition of the hypertorus topology.
    refvector<long> bases;
 
+   //! Uniform number in [0,1] from the random stream state of a replica (splitmix64).
+   static double uniform(ulong& state)
+   {
+      state+=0x9e3779b97f4a7c15UL;
+      ulong z=state;
+      z=(z ^ (z >> 30))*0xbf58476d1ce4e5b9UL;
+      z=(z ^ (z >> 27))*0x94d049bb133111ebUL;
+      z^=z >> 31;
+      return (double) (z >> 11)/(double) ((1UL << 53)-1);
+   }
+
+   //! Monte-Carlo move along the gradient from the local optimum conf1 at temperature temp.
+   /*!
+      Draws from random() if state is NULL and from the stream of a replica otherwise.
+      \return the pruned number of the new starting point.
+    */
+   ulong move(ulong conf1, const refvector<double>& lambda, double temp, ulong* state) const
+   {
+      ulong i,j;
+      long k;
+      refvector<valerg> valgrad(bases.size());
+      refvector<double> grad(valgrad.dim());
+      valgrad=opt_object.gradient(opt_object.lib_object_r.reprune(conf1),valgrad);
+      ulong number=0;
+
+      for(k=0,i=1;k<valgrad.size();k++)
+      {
+
+         j=(conf1-conf1%i)/i % bases[k];
+
+         grad[k]=valgrad[k].property-lambda*valgrad[k].penalty;
+
+         if(valgrad[k].property>-INFINITY && valgrad[k].property<INFINITY)
+         {
+
+            double p=1.0/(1.0+exp(grad[k]/temp));
+            double random_nr=(state==NULL) ? (double) random()/(double) RAND_MAX : uniform(*state);
+            if(random_nr > p)
+               j=(j+(long) (p*(double) bases[k]*0.5)%bases[k]) % bases[k];
+            else
+               j=(j+bases[k]-(long) (p*(double) bases[k]*0.5)%bases[k]) % bases[k];
+
+         }
+
+         number+=j*i;
+         i*=bases[k];
+      }
+      return number;
+   }
+
+   //! Report the new starting point conf1 with memo position config.
+   void print_start(long config, ulong conf1, const refvector<double>& lambda) const
+   {
+      cout << id_r+"::New starting value is: " << opt_object.lib_object_r.value_r[config].property;
+      cout << " Penalty: ";
+      opt_object.lib_object_r.value_r[config].penalty.display();
+      cout << " lambda: ";
+      lambda.display(cout);
+      cout  << " Result: " << (opt_object.lib_object_r.value_r[config].property-
+            opt_object.lib_object_r.value_r[config].penalty*lambda)
+                                       << " for compound #" << conf1 << endl;
+      cout.flush();
+   }
+
+   //! Best compound of the memo: the smallest penalty and, among equal penalties, the largest property.
+   ulong best() const
+   {
+      return opt_object.lib_object_r.visited_r[opt_object.lib_object_r.best_index()];
+   }
+
+   //! Local optimization and move of one replica.
+   /*!
+      \param start absolute number to optimize from.
+      \param k the replica, which selects the temperature.
+      \param state random stream of the replica, advanced by the move.
+      \param optimum the local optimum found.
+      \return the absolute number of the next starting point, which has been computed.
+    */
+   ulong replica_step(ulong start, long k, const refvector<double>& lambda, ulong& state, ulong& optimum) const
+   {
+      stringstream s;
+      s << id_r << "::replica" << k;
+      opt_object.set_id(s.str());
+      optimum=opt_object.optimize(start);
+      cout << s.str() << "::Gradient of " << optimum << endl;
+      cout.flush();
+      ulong number=move(optimum,lambda,T*pow(ladder,(double) k),&state);
+      opt_object.lib_object_r.compute_property(number);
+      return opt_object.lib_object_r.deprune(number);
+   }
+
+   //! One replica_step() run in a child process.
+   class replica_job : public pool_job
+   {
+   private:
+      const gen_base_gdmc<C>* driver;
+      ulong start;
+      long replica;
+      refvector<double> lambda;
+      ulong state;
+   public:
+      replica_job() : driver(NULL), start(0), replica(0), state(0) {};
+      replica_job(const gen_base_gdmc<C>& d, ulong s, long k, const refvector<double>& l, ulong r) :
+         driver(&d), start(s), replica(k), state(r) { lambda.copy(l); };
+
+      //! Returns the next start, the optimum, the random stream and the memo.
+      string run() const
+      {
+         ulong r=state;
+         ulong optimum;
+         checkpoint c;
+         c.put(driver->replica_step(start,replica,lambda,r,optimum));
+         c.put(optimum);
+         c.put(r);
+         c.put(driver->opt_object.lib_object_r.visited_r);
+         c.put(driver->opt_object.lib_object_r.value_r);
+         return c.str();
+      }
+   };
+
+   //! Advance all replicas by one step. starts and states are updated, optima receives the local optima.
+   /*!
+      The replicas always run in children, one after the other with a single
+      job, see the class description.
+    */
+   void run_replicas(refvector<ulong>& starts, const refvector<double>& lambda, refvector<ulong>& states, refvector<ulong>& optima) const
+   {
+      long n=starts.size();
+      long share=eval_pool::get_jobs()/n;
+      if(share<1) share=1;
+      vector<replica_job> jobs(n);
+      refvector<const pool_job*> list(n);
+      for(long k=0;k<n;k++) {
+         jobs[k]=replica_job(*this,starts[k],k,lambda,states[k]);
+         list[k]=&jobs[k];
+      }
+      refvector<string> raw=eval_pool::run_jobs(list,share);
+
+      for(long k=0;k<n;k++) {
+         optima[k]=starts[k];
+         try {
+            checkpoint c(raw[k]);
+            c.get(starts[k]);
+            c.get(optima[k]);
+            c.get(states[k]);
+            merge_child_memo(opt_object.lib_object_r,c);
+         } catch(exception& e) {
+            cerr << id_r << ": replica " << k << " did not report a result\n";
+         }
+      }
+   }
+
+   //! \f$P-\lambda \pi\f$ of a computed compound.
+   double objective(ulong conf, const refvector<double>& lambda) const
+   {
+      long config=opt_object.lib_object_r.visited_index(conf);
+      if(config<0) return -INFINITY;
+      const valerg& val=opt_object.lib_object_r.value_r[config];
+      return val.property-val.penalty*lambda;
+   }
+
+   //! Write the state of all replicas and the Library to the checkpoint file, if any.
+   void save_replicas(ulong steps, ulong round, const refvector<ulong>& starts, const refvector<ulong>& optima,
+         const refvector<ulong>& states, const refvector<double>& lambda) const
+   {
+      if(checkpoint::get_file()=="") return;
+      checkpoint c;
+      c.put(string("gen_base_gdmc replicas"));
+      c.put(steps);
+      c.put(round);
+      c.put(starts);
+      c.put(optima);
+      c.put(states);
+      c.put(lambda);
+      c.put_random();
+      opt_object.save_state(c);
+      c.write(checkpoint::get_file());
+   }
+
+   //! Restore the state written by save_replicas(). Returns false if there is nothing to resume.
+   bool load_replicas(ulong& steps, ulong& round, refvector<ulong>& starts, refvector<ulong>& optima,
+         refvector<ulong>& states, refvector<double>& lambda) const
+   {
+      string file=checkpoint::take_resume();
+      if(file=="") return false;
+      checkpoint c;
+      c.read(file);
+      c.expect("gen_base_gdmc replicas");
+      c.get(steps);
+      c.get(round);
+      c.get(starts);
+      c.get(optima);
+      c.get(states);
+      c.get(lambda);
+      c.get_random();
+      opt_object.load_state(c);
+      cout << id_r << "::Resumed from " << file << " at step " << steps << " round " << round << endl;
+      return true;
+   }
+
+   //! Replica exchange version of optimize().
+   /*!
+      All chains start from N. The last entry of the random streams decides on swaps.
+      Swaps are attempted between the chains k and k+1 for even k after even rounds
+      and odd k after odd rounds. Tightening follows the coldest chain.
+    */
+   ulong temper(ulong N) const
+   {
+      try {
+         long n=replicas;
+         refvector<double> lambda(opt_object.lib_object_r.get_number_of_constraints());
+         refvector<double> temperature(n);
+         for(long k=0;k<n;k++)
+            temperature[k]=T*pow(ladder,(double) k);
+         refvector<ulong> starts(n), optima(n), states(n+1);
+         ulong seed=random();
+         for(long k=0;k<=n;k++)
+            states[k]=seed+((ulong) k << 32);
+         for(long k=0;k<n;k++)
+            starts[k]=optima[k]=N;
+         ulong steps=1, round=0;
+         opt_object.set_id(id_r+"::opt_object");
+         load_replicas(steps,round,starts,optima,states,lambda);
+
+         while(tight_steps>=steps)
+         {
+            ulong previous=starts[0];
+            while(steps*max_steps/tight_steps>(ulong) opt_object.stacksize())
+            {
+               previous=starts[0];
+               run_replicas(starts,lambda,states,optima);
+               for(long k=0;k<n;k++) {
+                  cout << id_r << "::replica" << k << " at T=" << temperature[k] << ": ";
+                  print_start(opt_object.lib_object_r.visited_index(starts[k]),starts[k],lambda);
+               }
+
+               for(long k=round%2;k+1<n;k+=2) {
+                  if(!(temperature[k]>0.0)) continue;
+                  double f=objective(optima[k],lambda);
+                  double g=objective(optima[k+1],lambda);
+                  double a=exp((g-f)*(1.0/temperature[k]-1.0/temperature[k+1]));
+                  if(uniform(states[n])<a) {
+                     cout << id_r << "::Swapping replicas " << k << " and " << k+1 << endl;
+                     ulong x=starts[k]; starts[k]=starts[k+1]; starts[k+1]=x;
+                     x=optima[k]; optima[k]=optima[k+1]; optima[k+1]=x;
+                  }
+               }
+               round++;
+               save_replicas(steps,round,starts,optima,states,lambda);
+            }
+            ulong conf3=opt_object.lib_object_r.reprune(starts[0]);
+            long config=opt_object.lib_object_r.visited_index(starts[0]);
+            opt_object.lib_object_r.prune(lambda,
+                  conf3,
+                  previous,
+                  config);
+
+            lambda*=1.1;
+            cout << id_r+"::New lambda = " << endl;
+            lambda.display(cout);
+
+            steps++;
+         }
+         return best();
+      } catch(exception& e) {
+         cerr << e.what() << endl;
+         throw domain_error(id_r+"::gen_base_gdmc::temper(ulong N) const");
+      }
+   }
+
 public:
    //! Temperature.
    double T;
@@ -52,23 +343,65 @@ public:
    ulong tight_steps;
    //! Maximum number of steps.
    ulong max_steps;
+   //! Number of chains (--replicas).
+   long replicas;
+   //! Ratio of the temperatures of neighbouring chains (--ladder).
+   double ladder;
 
    gen_base_gdmc(const C& a, const refvector<long>& b) :
       opt_object(a),
       bases(b),
       T(0.0),
       tight_steps(1),
-      max_steps(2)
+      max_steps(2),
+      replicas(1),
+      ladder(2.0)
    {};
 
+   //! Write the loop state and the Library to the checkpoint file, if any.
+   void save_checkpoint(ulong steps, ulong conf1, ulong conf2, ulong conf3, long config, const refvector<double>& lambda) const
+   {
+      if(checkpoint::get_file()=="") return;
+      checkpoint c;
+      c.put(string("gen_base_gdmc"));
+      c.put(steps);
+      c.put(conf1);
+      c.put(conf2);
+      c.put(conf3);
+      c.put(config);
+      c.put(lambda);
+      c.put_random();
+      opt_object.save_state(c);
+      c.write(checkpoint::get_file());
+   }
+
+   //! Restore the state written by save_checkpoint(). Returns false if there is nothing to resume.
+   bool load_checkpoint(ulong& steps, ulong& conf1, ulong& conf2, ulong& conf3, long& config, refvector<double>& lambda) const
+   {
+      string file=checkpoint::take_resume();
+      if(file=="") return false;
+      checkpoint c;
+      c.read(file);
+      c.expect("gen_base_gdmc");
+      c.get(steps);
+      c.get(conf1);
+      c.get(conf2);
+      c.get(conf3);
+      c.get(config);
+      c.get(lambda);
+      c.get_random();
+      opt_object.load_state(c);
+      cout << id_r << "::Resumed from " << file << " at step " << steps << " with " << conf1 << endl;
+      return true;
+   }
+
    //! Gradient-directed Monte-Carlo optimization
    ulong optimize(ulong N) const
    {
+      if(replicas>1) return temper(N);
       try {
-         ulong i,j;
-         long k;
          ulong number=N;
-         long config=opt_object.lib_object_r.visited_r.contains(N);
+         long config=opt_object.lib_object_r.visited_index(N);
 
          refvector<double> lambda(opt_object.lib_object_r.get_number_of_constraints());
          ulong steps=1;
@@ -78,11 +411,8 @@ public:
          ulong conf1,conf2;
          conf1=number;
 
-         refvector<valerg> valgrad(bases.size());
-
-         refvector<double> grad(valgrad.dim());
-
-         ulong conf3;
+         ulong conf3=conf1;
+         load_checkpoint(steps,conf1,conf2,conf3,config,lambda);
          // tight_steps counts how often lambda is ramped.
          while(tight_steps>=steps)
          {
@@ -94,50 +424,17 @@ public:
                conf1=opt_object.optimize(conf1);
                cout << id_r+"::Gradient of " << conf1 << endl;
                cout.flush();
-               valgrad=opt_object.gradient(opt_object.lib_object_r.reprune(conf1),valgrad);
-               number=0;
-
-               for(k=0,i=1;k<valgrad.size();k++)
-               {
-
-                  j=(conf1-conf1%i)/i % bases[i];
-
-                  grad[k]=valgrad[k].property-lambda*valgrad[k].penalty;
-
-                  if(valgrad[k].property>-INFINITY && valgrad[k].property<INFINITY)
-                  {
-
-                     double p=1.0/(1.0+exp(grad[k]/T));
-                     double random_nr=(double) random()/(double) RAND_MAX;
-                     if(random_nr > p)
-                        j+=(long) (p*(double) bases[i]*0.5)%bases[i];
-                     else
-                        j-=(long) (p*(double) bases[i]*0.5)%bases[i];
-
-                  }
-
-                  number+=j*i;
-                  i*=bases[i];
-               }
-               conf1=number;
+               conf1=move(conf1,lambda,T,NULL);
 
                opt_object.lib_object_r.compute_property(conf1);
-               config=opt_object.lib_object_r.visited_r.contains(conf1);
+               config=opt_object.lib_object_r.visited_index(conf1);
                conf3=conf1;
                conf1=opt_object.lib_object_r.deprune(conf1);
 
-               cout << id_r+"::New starting value is: " << opt_object.lib_object_r.value_r[config].property;
-               cout << " Penalty: ";
-               opt_object.lib_object_r.value_r[config].penalty.display();
-               cout << " lambda: ";
-               lambda.display(cout);
-               cout  << " Result: " << (opt_object.lib_object_r.value_r[config].property-
-                     opt_object.lib_object_r.value_r[config].penalty*lambda)
-								               << " for compound #" << conf1 << endl;
-               cout.flush();
+               print_start(config,conf1,lambda);
 
                // Single optimization run done.
-
+               save_checkpoint(steps,conf1,conf2,conf3,config,lambda);
             }
             opt_object.lib_object_r.prune(lambda,
                   conf3,
@@ -150,17 +447,7 @@ public:
 
             steps++;
          }
-         conf1=0;
-         for(i=0;i<opt_object.lib_object_r.visited_r.size();i++)
-         {
-            if(opt_object.lib_object_r.value_r[i].penalty*opt_object.lib_object_r.value_r[i].penalty<=
-                  opt_object.lib_object_r.value_r[conf1].penalty*opt_object.lib_object_r.value_r[conf1].penalty)
-               if(!(opt_object.lib_object_r.value_r[i].penalty==opt_object.lib_object_r.value_r[conf1].penalty) ||
-                     opt_object.lib_object_r.value_r[i].property > opt_object.lib_object_r.value_r[conf1].property)
-                  conf1=i;
-         }
-         conf1=opt_object.lib_object_r.visited_r[conf1];
-         return conf1;
+         return best();
       } catch(exception& e) {
          cerr << e.what() << endl;
          throw domain_error(id_r+"::gen_base_gdmc::optimize(ulong N) const");
@@ -45,18 +45,20 @@ refvector<valerg>& has_gradients_data<X>::gradient(ulong i, refvector<valerg>& v
    try {
       v.resize(get_bits());
       long maxN=get_space_size();
-      long n1, n2, m, k;
-      valerg a,b;
-      long lbits=0;
-      for(k=1;k<maxN;k*=2,lbits++)
+      long n1, m, k;
+      long lbits;
+      // Both neighbors of every bit are evaluated in one batch.
+      refvector<ulong> N;
+      for(k=1;k<maxN;k*=2)
       {
          m=((i-i%k)/k)%2;
          n1=i-m*k;
-         n2=n1+k;
-         a=X::compute_property(n1);
-         b=X::compute_property(n2);
-         v[lbits]=b-a;
+         N.push_back(n1);
+         N.push_back(n1+k);
       }
+      refvector<valerg> r=X::compute_properties(N);
+      for(lbits=0;2*lbits<N.size();lbits++)
+         v[lbits]=r[2*lbits+1]-r[2*lbits];
    }
    catch (exception& e) {
       cerr << e.what() << endl;
@@ -0,0 +1,302 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file island_model.hh \brief Island model of concurrent local searches with migration.
+
+#ifndef _ISLAND_MODEL_HH_
+#define _ISLAND_MODEL_HH_
+
+#include <typedefs.hh>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <optimizeabstract.h>
+#include <BCR_CPP_LA/linear_algebra.h>
+#include <Library_data.hh>
+#include <binary_line_search.hh>
+#include <genbase-grad-ls.hh>
+#include <entropic_aux.hh>
+#include <eval_pool.hh>
+#include <checkpoint.hh>
+#include <local_search_batch.hh>
+
+using namespace std;
+using namespace linear_algebra;
+
+//! The Library searched by a binary_line_search, which is the Library itself.
+template<class X>
+const Library_data& island_library(const binary_line_search<X>& o) { return o; }
+
+//! The Library searched by a gen_base_grad_LS.
+template<class X, class B>
+const Library_data& island_library(const gen_base_grad_LS<X,B>& o) { return o.lib_object_r; }
+
+//! Meta-Optimize with several concurrent local searches that exchange their results.
+template<class C>
+class island_model: public optimize_abstract
+/*!
+   Each island runs the secondary optimizer C from its own start
+   with its own Lagrange multipliers. The first island starts from the given
+   compound, the others from compounds maximally distant from it (see
+   maximize_entropic_distances()). C has to provide
+   ulong optimize(ulong N, refvector<double>& lambda, refvector<ulong>& visited_run) const,
+   as binary_line_search and gen_base_grad_LS do.
+
+   The islands do not share one memo while they run. The searches of an
+   epoch run as children of eval_pool::run_jobs() with an equal share of the
+   --jobs slots, since the optimizers keep their state unsynchronized, and
+   each child searches a private copy of the memo. Values are therefore
+   reused across islands only at epoch boundaries: within an epoch two
+   islands may evaluate the same compound. Each child returns its compound,
+   its multipliers and its new values; any other state, such as the numbers
+   its pruner discarded, is lost with the child. After each epoch the values
+   computed by all islands are merged into the memo of the Library, which all
+   islands see in the next epoch, and the results migrate along a ring: island k receives the
+   compound found by island k-1. If that compound is better than its own
+   under the multipliers of island k, island k continues from it with the
+   larger of both multipliers. Otherwise its search has converged and it
+   restarts from the compound most distant from everything computed so far.
+ */
+{
+protected:
+   //! Optimization object of type C. This is the underlying optimization method.
+   C opt_object;
+   //! Substitution bases used for the diversity of the starts.
+   refvector<long> bases;
+
+   //! The Library shared by the islands.
+   const Library_data& library() const { return island_library(opt_object); }
+
+   //! \f$P-\lambda \pi\f$ of the memo entry config. Multipliers of the wrong size count as zero.
+   double objective(long config, const refvector<double>& lambda) const
+   {
+      const valerg& val=library().value_r[config];
+      if(lambda.size()!=val.penalty.size()) return val.property;
+      return val.property-lambda*val.penalty;
+   }
+
+   //! Element-wise maximum of two sets of multipliers.
+   static refvector<double> larger(const refvector<double>& a, const refvector<double>& b)
+   {
+      refvector<double> r;
+      if(a.size()!=b.size()) {
+         r.copy((a.size()>b.size()) ? a : b);
+         return r;
+      }
+      r.copy(a);
+      for(long i=0;i<r.size();i++)
+         if(b[i]>r[i]) r[i]=b[i];
+      return r;
+   }
+
+   //! One search of an island, run in a child process.
+   class island_job : public pool_job
+   {
+   private:
+      const island_model<C>* driver;
+      ulong start;
+      refvector<double> lambda;
+      long island;
+   public:
+      island_job() : driver(NULL), start(0), island(0) {};
+      island_job(const island_model<C>& d, ulong s, const refvector<double>& l, long k) :
+         driver(&d), start(s), island(k) { lambda.copy(l); };
+
+      //! Returns the compound found, the final multipliers and the memo.
+      string run() const
+      {
+         refvector<double> l;
+         l.copy(lambda);
+         checkpoint c;
+         c.put(driver->island_search(start,l,island));
+         c.put(l);
+         c.put(driver->library().visited_r);
+         c.put(driver->library().value_r);
+         return c.str();
+      }
+   };
+
+   //! Run one epoch of all islands. lambdas holds the multipliers of each island and is updated.
+   refvector<ulong> run_islands(const refvector<ulong>& starts, refvector<refvector<double> >& lambdas) const
+   {
+      long n=starts.size();
+      refvector<ulong> found(n);
+      if(eval_pool::get_jobs()<2 || n<2) {
+         for(long k=0;k<n;k++)
+            found[k]=island_search(starts[k],lambdas[k],k);
+         return found;
+      }
+
+      long share=eval_pool::get_jobs()/n;
+      if(share<1) share=1;
+      vector<island_job> jobs(n);
+      refvector<const pool_job*> list(n);
+      for(long k=0;k<n;k++) {
+         jobs[k]=island_job(*this,starts[k],lambdas[k],k);
+         list[k]=&jobs[k];
+      }
+      refvector<string> raw=eval_pool::run_jobs(list,share);
+
+      for(long k=0;k<n;k++) {
+         found[k]=starts[k];
+         try {
+            checkpoint c(raw[k]);
+            refvector<double> l;
+            c.get(found[k]);
+            c.get(l);
+            lambdas[k]=l;
+            merge_child_memo(library(),c);
+         } catch(exception& e) {
+            cerr << id_r << ": island " << k << " did not report a result\n";
+         }
+      }
+      return found;
+   }
+
+public:
+   //! Number of islands (--islands).
+   long islands;
+   //! Number of epochs.
+   ulong epochs;
+   //! Maximum number of steps.
+   long max_steps;
+
+   island_model(const C& a, const refvector<long>& b) :
+      opt_object(a), bases(b), islands(2), epochs(1), max_steps(0) {};
+
+   //! Run the secondary optimizer of island k from start with the multipliers lambda.
+   ulong island_search(ulong start, refvector<double>& lambda, long k) const
+   {
+      stringstream s;
+      s << id_r << "::island" << k;
+      opt_object.set_id(s.str());
+      refvector<ulong> visited_run;
+      return opt_object.optimize(start,lambda,visited_run);
+   }
+
+   //! Write the number of completed epochs, the next starts, the multipliers and the Library to the checkpoint file, if any.
+   void save_checkpoint(ulong epoch, const refvector<ulong>& starts, const refvector<refvector<double> >& lambdas) const
+   {
+      if(checkpoint::get_file()=="") return;
+      checkpoint c;
+      c.put(string("island_model"));
+      c.put(epoch);
+      c.put(starts);
+      c.put(lambdas);
+      c.put_random();
+      library().save_state(c);
+      c.write(checkpoint::get_file());
+   }
+
+   //! Restore the state written by save_checkpoint(). Returns false if there is nothing to resume.
+   bool load_checkpoint(ulong& epoch, refvector<ulong>& starts, refvector<refvector<double> >& lambdas) const
+   {
+      string file=checkpoint::take_resume();
+      if(file=="") return false;
+      checkpoint c;
+      c.read(file);
+      c.expect("island_model");
+      c.get(epoch);
+      c.get(starts);
+      c.get(lambdas);
+      c.get_random();
+      library().load_state(c);
+      cout << id_r << " Resumed from " << file << " at epoch " << epoch << endl;
+      return true;
+   }
+
+   //! Meta-Optimize with islands starting from N and mutually distant compounds.
+   ulong optimize(ulong N) const
+   {
+      try {
+         long M=(islands>1) ? islands : 1;
+         refvector<ulong> starts(1);
+         starts[0]=N;
+         if(M>1) {
+            refvector<ulong> others=maximize_entropic_distances(starts,bases,M-1);
+            for(long k=0;k<others.size();k++)
+               starts.push_back(others[k]);
+         }
+         refvector<refvector<double> > lambdas(starts.size());
+         ulong epoch=0;
+         load_checkpoint(epoch,starts,lambdas);
+
+         while(epoch<epochs && max_steps>library().visited_r.size())
+         {
+            long n=starts.size();
+            cout << id_r << " Starting epoch " << epoch << " with";
+            for(long k=0;k<n;k++)
+               cout << " " << starts[k];
+            cout << endl;
+            refvector<ulong> found=run_islands(starts,lambdas);
+            for(long k=0;k<n;k++) {
+               long config=library().visited_index(found[k]);
+               if(config<0) continue;
+               cout << id_r << ":The optimized value of island " << k << " in epoch " << epoch << " is: " << library().value_r[config].property;
+               cout << " Penalty: ";
+               library().value_r[config].penalty.display();
+               cout << id_r << " for compound #" << found[k] << endl;
+               cout.flush();
+            }
+            epoch++;
+
+            // Migration along the ring.
+            refvector<ulong> fresh=maximize_entropic_distances(library().visited_r,bases,n);
+            long used=0;
+            refvector<ulong> next(n);
+            refvector<refvector<double> > next_lambdas(n);
+            for(long k=0;k<n;k++) {
+               long j=(k+n-1)%n;
+               long own=library().visited_index(found[k]);
+               long migrant=library().visited_index(found[j]);
+               if(j!=k && own>=0 && migrant>=0 &&
+                     objective(migrant,lambdas[k])>objective(own,lambdas[k])) {
+                  cout << id_r << " Island " << k << " continues from " << found[j] << " of island " << j << endl;
+                  next[k]=found[j];
+                  next_lambdas[k]=larger(lambdas[k],lambdas[j]);
+               } else {
+                  next[k]=(used<fresh.size()) ? fresh[used++] : found[k];
+                  next_lambdas[k].copy(lambdas[k]);
+               }
+            }
+            starts=next;
+            lambdas=next_lambdas;
+            save_checkpoint(epoch,starts,lambdas);
+         }
+         cout << id_r << " Total Visited configurations ";
+         library().visited_r.display();
+         cout << endl;
+         cout << id_r << "Number of configurations: " << library().visited_r.dim() << endl;
+
+         return library().visited_r[library().best_index()];
+      } catch(exception& e) {
+         cerr << e.what() << endl;
+         throw domain_error("called by island_model::optimize(ulong N) const");
+      }
+   }
+
+   valerg get_value(const ulong i) const
+   {
+      return library().get_value(i);
+   }
+
+   void set_compute_property_flag(bool B) const {opt_object.set_compute_property_flag(B);}
+};
+
+#endif // _ISLAND_MODEL_HH_
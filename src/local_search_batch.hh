@@ -0,0 +1,133 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file local_search_batch.hh \brief Concurrent local searches of the entropic and island drivers.
+
+#ifndef _LOCAL_SEARCH_BATCH_HH_
+#define _LOCAL_SEARCH_BATCH_HH_
+
+#include <typedefs.hh>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <BCR_CPP_LA/linear_algebra.h>
+#include <eval_pool.hh>
+#include <checkpoint.hh>
+#include <synthetic_landscape.hh>
+
+using namespace std;
+using namespace linear_algebra;
+
+//! One local search of a driver D on a Library L, run in a child process.
+template<class D, class L>
+class local_search_job : public pool_job
+/*!
+   The child returns the compound found by D::local_search() and its
+   complete memo serialized with checkpoint.
+ */
+{
+private:
+   const D* driver;
+   const L* lib;
+   ulong start;
+public:
+   local_search_job() : driver(NULL), lib(NULL), start(0) {};
+   local_search_job(const D& d, const L& l, ulong s) : driver(&d), lib(&l), start(s) {};
+
+   string run() const
+   {
+      checkpoint c;
+      c.put(driver->local_search(start));
+      c.put(lib->visited_r);
+      c.put(lib->value_r);
+      return c.str();
+   }
+};
+
+//! Read a memo written by a child with checkpoint::put(visited_r) and put(value_r) and merge it into lib.
+/*!
+   Values that were computed by the child on a synthetic landscape are
+   counted as if they had been computed here.
+ */
+template<class L>
+void merge_child_memo(const L& lib, checkpoint& c)
+{
+   refvector<ulong> N;
+   refvector<valerg> V;
+   c.get(N);
+   c.get(V);
+   long added=lib.merge_memo(N,V);
+   if(synthetic_landscape::is_active())
+      for(long i=lib.visited_r.size()-added;i<lib.visited_r.size();i++)
+         synthetic_landscape::record(lib.value_r[i]);
+}
+
+//! Run the local searches of driver from all starts at once and merge their memos into lib.
+/*!
+   Each search runs in a child process of eval_pool::run_jobs() with an equal
+   share of the --jobs slots. The searches do not see each other's values
+   while they run; afterwards, the values they computed are added to the
+   memo of lib in the order of starts, so that the next batch and the final
+   selection see all of them. Any other state the searches build up (e.g.,
+   pruned numbers) stays in the children. With a single slot the searches
+   run one after the other in this process and share the memo directly.
+   \param driver provides ulong local_search(ulong start) const, returning the library number found.
+   \param lib the Library whose memo the searches fill.
+   \param starts library numbers to start from.
+   \return the numbers found, in the order of starts. Failed searches return their start.
+ */
+template<class D, class L>
+refvector<ulong> run_local_searches(const D& driver, const L& lib, const refvector<ulong>& starts)
+{
+   try {
+      long n=starts.size();
+      refvector<ulong> found(n);
+      if(eval_pool::get_jobs()<2 || n<2) {
+         for(long k=0;k<n;k++)
+            found[k]=driver.local_search(starts[k]);
+         return found;
+      }
+
+      long share=eval_pool::get_jobs()/n;
+      if(share<1) share=1;
+      vector<local_search_job<D,L> > jobs(n);
+      refvector<const pool_job*> list(n);
+      for(long k=0;k<n;k++) {
+         jobs[k]=local_search_job<D,L>(driver,lib,starts[k]);
+         list[k]=&jobs[k];
+      }
+      refvector<string> raw=eval_pool::run_jobs(list,share);
+
+      for(long k=0;k<n;k++) {
+         found[k]=starts[k];
+         try {
+            checkpoint c(raw[k]);
+            c.get(found[k]);
+            merge_child_memo(lib,c);
+         } catch(exception& e) {
+            cerr << "run_local_searches: the search from " << starts[k] << " did not report a result\n";
+         }
+      }
+      return found;
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by run_local_searches(const D& driver, const L& lib, const refvector<ulong>& starts)");
+   }
+}
+
+#endif // _LOCAL_SEARCH_BATCH_HH_
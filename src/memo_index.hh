@@ -0,0 +1,131 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file memo_index.hh \brief Hash index of the visited numbers of a Library.
+
+#ifndef _MEMO_INDEX_HH
+#define _MEMO_INDEX_HH
+
+#include <BCR_CPP_LA/refcount.decl>
+#include <typedefs.hh>
+
+using namespace linear_algebra;
+
+//! Open addressing hash table from library numbers to their position in Library_data::visited.
+class memo_index
+/*!
+   The index follows the list it refers to lazily: entries appended to the list
+   are added on the next lookup, and a shrunken list causes a rebuild. Lookups
+   verify the stored position, so a stale index is rebuilt rather than trusted.
+   Only a wholesale replacement of the list must be announced with clear().
+ */
+{
+private:
+   //! Library numbers, valid where slots is not -1.
+   refvector<ulong> keys;
+
+   //! Position in the indexed list, -1 for empty buckets.
+   refvector<long> slots;
+
+   //! Number of list entries that have been indexed.
+   long count;
+
+   //! Mix the bits of a library number (splitmix64 finalizer).
+   static ulong hash(ulong k)
+   {
+      k^=k >> 30;
+      k*=0xbf58476d1ce4e5b9UL;
+      k^=k >> 27;
+      k*=0x94d049bb133111ebUL;
+      k^=k >> 31;
+      return k;
+   }
+
+   //! Insert a number unless it is already present (the first occurrence wins).
+   void insert(ulong key, long slot)
+   {
+      if(2*(count+1)>slots.size()) grow();
+      ulong mask=slots.size()-1;
+      ulong b=hash(key) & mask;
+      while(slots[b]>=0) {
+         if(keys[b]==key) return;
+         b=(b+1) & mask;
+      }
+      keys[b]=key;
+      slots[b]=slot;
+   }
+
+   //! Double the number of buckets and reinsert.
+   void grow()
+   {
+      refvector<ulong> oldkeys=keys;
+      refvector<long> oldslots=slots;
+      long n=(oldslots.size()>0) ? 2*oldslots.size() : 64;
+      keys=refvector<ulong>(n);
+      slots=refvector<long>(n);
+      for(long b=0;b<n;b++) slots[b]=-1;
+      ulong mask=n-1;
+      for(long b=0;b<oldslots.size();b++) {
+         if(oldslots[b]<0) continue;
+         ulong c=hash(oldkeys[b]) & mask;
+         while(slots[c]>=0) c=(c+1) & mask;
+         keys[c]=oldkeys[b];
+         slots[c]=oldslots[b];
+      }
+   }
+
+public:
+   //! Default constructor
+   memo_index() : keys(), slots(), count(0) {};
+
+   //! Copy constructor. The copy starts empty and is rebuilt on demand.
+   memo_index(const memo_index& a) : keys(), slots(), count(0) {};
+
+   //! Assignment. The index is rebuilt on demand.
+   memo_index& operator=(const memo_index& a) { clear(); return *this; }
+
+   //! Forget all entries.
+   void clear()
+   {
+      keys=refvector<ulong>();
+      slots=refvector<long>();
+      count=0;
+   }
+
+   //! Position of key in list or -1. Equivalent to list.contains(key).
+   long find(ulong key, const refvector<ulong>& list)
+   {
+      if(count>list.size()) clear();
+      for(;count<list.size();count++)
+         insert(list[count],count);
+      if(slots.size()==0) return -1;
+      ulong mask=slots.size()-1;
+      ulong b=hash(key) & mask;
+      while(slots[b]>=0) {
+         if(keys[b]==key) {
+            if(list[slots[b]]==key) return slots[b];
+            clear();
+            return find(key,list);
+         }
+         b=(b+1) & mask;
+      }
+      return -1;
+   }
+};
+
+#endif
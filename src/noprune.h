@@ -31,9 +31,11 @@ class noprune : public pruner_abstract<X>
 public:
 
    using pruner_abstract<X>::visited_r;
+   using pruner_abstract<X>::visited_index;
    using pruner_abstract<X>::value_r;
    using pruner_abstract<X>::prune;
    using pruner_abstract<X>::get_badval;
+   using pruner_abstract<X>::penalty_products;
 
    bool minimax;
 
@@ -52,7 +54,7 @@ public:
    //! Compute the increase of lambda and assess current best value.
    void adjust_lagrange(refvector<double> &oldlambda, ulong & conf1, ulong & conf2, long &config, const refvector<ulong>& visited_run) const
    {
-      config=visited_r.contains(deprune(conf1));
+      config=visited_index(deprune(conf1));
       const ulong conf3=deprune(conf1); // save original
       string serr="reorder_general_base<X>::adjust_lagrange(double& lambda,ulong& conf1,ulong& conf2,long& config)";
       if(config<0)
@@ -70,34 +72,46 @@ public:
          // smallest penalty and largest property.
          try {
             conf1=visited_r[config];
-
-            for(i=0;i< visited_run.size() &&
+            // Products of the penalties of the run with both multipliers, see value_columns.
+            // Position k of at holds the memo index of visited_run[k], followed by config and min_max.
+            long n=visited_run.size();
+            vector<long> at(n+2);
+            for(i=0;i<n;i++)
+               at[i]=visited_index(visited_run[i]);
+            const long c=n;
+            long m=n+1;
+            at[c]=config;
+            at[m]=min_max;
+            vector<double> pn, po;
+            penalty_products(newlambda,at,pn);
+            penalty_products(oldlambda,at,po);
+
+            for(i=0;i<n &&
             (
-                  (value_r[config].penalty-
-                        value_r[visited_r.contains(visited_run[i])].penalty)*newlambda<1e-16 ||
-                        value_r[visited_r.contains(visited_run[i])].penalty == get_badval().penalty
+                  pn[c]-pn[i]<1e-16 ||
+                        value_r[at[i]].penalty == get_badval().penalty
             )
             ;i++)
             {
-               j=visited_r.contains(visited_run[i]);
+               j=at[i];
                // min
-               if (value_r[min_max].penalty*newlambda>=
-                     value_r[j].penalty*newlambda)
+               if (pn[m]>=pn[i])
                   // max
-                  if (!(value_r[min_max].penalty*newlambda==
-                        value_r[j].penalty*newlambda &&
-                        value_r[min_max].property-value_r[min_max].penalty*oldlambda>=
-                        value_r[j].property-value_r[j].penalty*oldlambda)
-                  )
+                  if (!(pn[m]==pn[i] &&
+                        value_r[min_max].property-po[m]>=
+                        value_r[j].property-po[i])
+                  ) {
                      min_max=j;
+                     m=i;
+                  }
             }
-            if(i< visited_run.size())
+            if(i<n)
             {
-               j=visited_r.contains(visited_run[i]);
-               if(value_r[config].penalty*newlambda>value_r[j].penalty*newlambda)
+               j=at[i];
+               if(pn[c]>pn[i])
                   lambda=
-                        fabs((value_r[config].property-value_r[config].penalty*oldlambda-
-                              (value_r[j].property-value_r[j].penalty*oldlambda))
+                        fabs((value_r[config].property-po[c]-
+                              (value_r[j].property-po[i]))
                               /
                               ((value_r[config].penalty-value_r[j].penalty)*newlambda)
                         );
@@ -105,27 +119,27 @@ public:
                conf1=visited_r[j];
                i++;
             }
-            for(; i< visited_run.size(); i++) {
-               j=visited_r.contains(visited_run[i]);
+            for(; i<n; i++) {
+               j=at[i];
                // min
-               if (value_r[min_max].penalty*newlambda>=
-                     value_r[j].penalty*newlambda)
+               if (pn[m]>=pn[i])
                   // max
-                  if (!(value_r[min_max].penalty*newlambda==
-                        value_r[j].penalty*newlambda &&
-                        value_r[min_max].property-value_r[min_max].penalty*oldlambda>
-                  value_r[j].property-value_r[j].penalty*oldlambda)
-                  )
+                  if (!(pn[m]==pn[i] &&
+                        value_r[min_max].property-po[m]>
+                  value_r[j].property-po[i])
+                  ) {
                      min_max=j;
+                     m=i;
+                  }
 
-               if(fabs(value_r[config].property-value_r[config].penalty*oldlambda-value_r[j].property+value_r[j].penalty*oldlambda)
+               if(fabs(value_r[config].property-po[c]-value_r[j].property+po[i])
                      <
                      ((value_r[config].penalty-value_r[j].penalty)*newlambda)*lambda
                )
                {
                   lambda=
                         fabs(
-                              (value_r[config].property-value_r[config].penalty*oldlambda-value_r[j].property+value_r[j].penalty*oldlambda)
+                              (value_r[config].property-po[c]-value_r[j].property+po[i])
                               /
                               ((value_r[config].penalty-value_r[j].penalty)*newlambda)
                         );
@@ -149,7 +163,7 @@ public:
          //minimize the penalty
          for(i=0;i<visited_run.size();i++)
          {
-            j=visited_r.contains(visited_run[i]);
+            j=visited_index(visited_run[i]);
             // If at least one component is lower
             if(lesseq<double>(value_r[j].penalty,min))
                // Only if ALL components are lower or the property value increases
@@ -189,7 +203,7 @@ public:
       }
       else conf2=deprune(conf2);//keep conf2 as before
 
-      config=visited_r.contains(conf1);
+      config=visited_index(conf1);
    }
 
 
@@ -0,0 +1,231 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file penalty_vector.hh \brief Constraint violations of a valerg, stored inline when few.
+
+#ifndef _PENALTY_VECTOR_HH
+#define _PENALTY_VECTOR_HH
+
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <BCR_CPP_LA/refcount.decl>
+
+//! Number of constraints (nconstraints) stored without allocation. Override with -DDCCSO_INLINE_CONSTRAINTS=n.
+#ifndef DCCSO_INLINE_CONSTRAINTS
+#define DCCSO_INLINE_CONSTRAINTS 8
+#endif
+
+//! Vector of penalties with inline storage for few constraints.
+class penalty_vector
+/*!
+   The number of constraints is fixed for a run and usually small, so up to
+   DCCSO_INLINE_CONSTRAINTS penalties are kept in an array inside the object
+   instead of a refvector. A valerg is thus copied without allocation or
+   reference counting, which matters for the gradients and the Lagrangian
+   scans that create and combine valergs in tight loops. Larger vectors are
+   allocated on the heap and copied deeply; any number of constraints works.
+
+   The interface follows the parts of refvector<double> used for penalties:
+   indexing, size(), zero(), display(), elementwise sums and differences,
+   scaling and dot products, also with a refvector<double> of multipliers.
+   A penalty_vector converts to a refvector<double> where one is required.
+   Operands of different sizes are an error.
+ */
+{
+private:
+   double local[DCCSO_INLINE_CONSTRAINTS];
+   //! local, or a heap array if n exceeds capacity.
+   double* p;
+   long n;
+
+   //! Make room for m entries, discarding the contents.
+   void allocate(long m)
+   {
+      if(m<0) throw std::domain_error("penalty_vector: negative number of constraints");
+      if(p!=local && m!=n) {
+         delete[] p;
+         p=local;
+      }
+      if(m>capacity && p==local) p=new double[m];
+      n=m;
+   }
+
+   void check(const penalty_vector& a) const
+   {
+      if(a.n!=n) throw std::domain_error("penalty_vector: different numbers of constraints");
+   }
+
+   void check(const linear_algebra::refvector<double>& a) const
+   {
+      if(a.size()!=n) throw std::domain_error("penalty_vector: different numbers of constraints");
+   }
+
+public:
+   //! Number of entries stored inline.
+   static const long capacity=DCCSO_INLINE_CONSTRAINTS;
+
+   //! Empty vector.
+   penalty_vector() : p(local), n(0) {};
+
+   //! Vector of m zeros.
+   explicit penalty_vector(long m) : p(local), n(0)
+   {
+      allocate(m);
+      for(long i=0;i<n;i++) p[i]=0.0;
+   }
+
+   //! Copy of a.
+   explicit penalty_vector(const linear_algebra::refvector<double>& a) : p(local), n(0)
+   {
+      allocate(a.size());
+      for(long i=0;i<n;i++) p[i]=a[i];
+   }
+
+   //! Copy constructor.
+   penalty_vector(const penalty_vector& a) : p(local), n(0)
+   {
+      allocate(a.n);
+      for(long i=0;i<n;i++) p[i]=a.p[i];
+   }
+
+   //! Move constructor. Takes over the heap array of a, if any.
+   penalty_vector(penalty_vector&& a) : p(local), n(0)
+   {
+      *this=std::move(a);
+   }
+
+   ~penalty_vector() { if(p!=local) delete[] p; }
+
+   penalty_vector& operator=(const penalty_vector& a)
+   {
+      if(&a==this) return *this;
+      allocate(a.n);
+      for(long i=0;i<n;i++) p[i]=a.p[i];
+      return *this;
+   }
+
+   penalty_vector& operator=(penalty_vector&& a)
+   {
+      if(&a==this) return *this;
+      if(a.p==a.local) return *this=a;
+      if(p!=local) delete[] p;
+      p=a.p;
+      n=a.n;
+      a.p=a.local;
+      a.n=0;
+      return *this;
+   }
+
+   //! Copy into a refvector.
+   operator linear_algebra::refvector<double>() const
+   {
+      linear_algebra::refvector<double> r(n);
+      for(long i=0;i<n;i++) r[i]=p[i];
+      return r;
+   }
+
+   long size() const { return n; }
+   long dim() const { return n; }
+   double& operator[](long i) { return p[i]; }
+   const double& operator[](long i) const { return p[i]; }
+
+   void zero() { for(long i=0;i<n;i++) p[i]=0.0; }
+
+   //! Output in the format of refvector::display().
+   void display(std::ostream& o=std::cout) const { linear_algebra::refvector<double>(*this).display(o); }
+
+   penalty_vector& operator+=(const penalty_vector& a)
+   {
+      check(a);
+      for(long i=0;i<n;i++) p[i]+=a.p[i];
+      return *this;
+   }
+
+   penalty_vector& operator-=(const penalty_vector& a)
+   {
+      check(a);
+      for(long i=0;i<n;i++) p[i]-=a.p[i];
+      return *this;
+   }
+
+   penalty_vector& operator*=(double b)
+   {
+      for(long i=0;i<n;i++) p[i]*=b;
+      return *this;
+   }
+
+   //! Dot product.
+   double operator*(const penalty_vector& a) const
+   {
+      check(a);
+      double s=0.0;
+      for(long i=0;i<n;i++) s+=p[i]*a.p[i];
+      return s;
+   }
+
+   //! Dot product with multipliers.
+   double operator*(const linear_algebra::refvector<double>& a) const
+   {
+      check(a);
+      double s=0.0;
+      for(long i=0;i<n;i++) s+=p[i]*a[i];
+      return s;
+   }
+
+   bool operator==(const penalty_vector& a) const
+   {
+      if(a.n!=n) return false;
+      for(long i=0;i<n;i++)
+         if(p[i]!=a.p[i]) return false;
+      return true;
+   }
+
+   bool operator!=(const penalty_vector& a) const { return !(*this==a); }
+};
+
+inline penalty_vector operator+(penalty_vector a, const penalty_vector& b) { a+=b; return a; }
+inline penalty_vector operator-(penalty_vector a, const penalty_vector& b) { a-=b; return a; }
+inline penalty_vector operator*(penalty_vector a, double b) { a*=b; return a; }
+
+//! Dot product with multipliers.
+inline double operator*(const linear_algebra::refvector<double>& a, const penalty_vector& b)
+{
+   double s=0.0;
+   if(a.size()!=b.size()) throw std::domain_error("penalty_vector: different numbers of constraints");
+   for(long i=0;i<b.size();i++) s+=a[i]*b[i];
+   return s;
+}
+
+//! Subtract penalties from a refvector.
+inline linear_algebra::refvector<double>& operator-=(linear_algebra::refvector<double>& a, const penalty_vector& b)
+{
+   if(a.size()!=b.size()) throw std::domain_error("penalty_vector: different numbers of constraints");
+   for(long i=0;i<b.size();i++) a[i]-=b[i];
+   return a;
+}
+
+inline penalty_vector atan(penalty_vector a)
+{
+   for(long i=0;i<a.size();i++)
+      a[i]=std::atan(a[i]);
+   return a;
+}
+
+#endif
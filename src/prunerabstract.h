@@ -22,6 +22,8 @@
 #define _PRUNERABSTRACT_H_
 
 #include <BCR_CPP_LA/refcount.h>
+#include <checkpoint.hh>
+#include <rank_select.hh>
 
 //! Abstract class implementing the pruner concept.
 template <class X>
@@ -34,6 +36,7 @@ public:
    pruner_abstract():
       X(),
       pruned_visited(),
+      pruned_index(),
       visited(X::visited),
       value(X::value),
       bits_computed(false),
@@ -44,6 +47,7 @@ public:
    pruner_abstract(const pruner_abstract<X>& a) :
       X(a),
       pruned_visited(a.pruned_visited),
+      pruned_index(),
       visited(X::visited),
       value(X::value),
       bits_computed(false),
@@ -53,6 +57,7 @@ public:
    {
       (X&) *this = (X&) A;
       pruned_visited=A.pruned_visited;
+      pruned_index.clear();
       return *this;
    }
 
@@ -61,6 +66,14 @@ public:
       return X::compute_property(deprune(N));
    }
 
+   //! Batch version of compute_property(ulong N).
+   refvector<valerg> compute_properties(const refvector<ulong>& N) const {
+      refvector<ulong> D(N.size());
+      for(long k=0;k<N.size();k++)
+         D[k]=deprune(N[k]);
+      return X::compute_properties(D);
+   }
+
    //! Adjust the space_size to reflect the absence of pruned values
    ulong get_space_size() const {
       if(!space_size_computed) {
@@ -80,6 +93,23 @@ public:
       return bits;
    }
 
+   //! Append the memo and the pruned numbers to a checkpoint.
+   void save_state(checkpoint& c) const
+   {
+      X::save_state(c);
+      c.put(pruned_visited);
+   }
+
+   //! Restore the state written by save_state().
+   void load_state(checkpoint& c) const
+   {
+      X::load_state(c);
+      c.get(pruned_visited);
+      pruned_index.clear();
+      space_size_computed=false;
+      bits_computed=false;
+   }
+
    //! Same as compute_property(ulong N), but absolute numbering
    valerg get_value(ulong N) const { return X::get_value(N); }
 
@@ -97,6 +127,9 @@ protected:
    //! List of pruned indices in Library.
    mutable	refvector<ulong> pruned_visited;
 
+   //! Rank and select index over pruned_visited, for pruners that keep it sorted.
+   mutable rank_select pruned_index;
+
    //! Reference to Library::visited.
    refvector<ulong>& visited;
 
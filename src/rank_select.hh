@@ -0,0 +1,98 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file rank_select.hh \brief Rank and select over the pruned numbers of a Library.
+
+#ifndef _RANK_SELECT_HH
+#define _RANK_SELECT_HH
+
+#include <BCR_CPP_LA/refcount.decl>
+#include <typedefs.hh>
+
+using namespace linear_algebra;
+
+//! Rank and select over an ascending list of distinct library numbers.
+class rank_select
+/*!
+   For the list p, rank(N) is the number of entries not larger than N and
+   select(N) is the N-th number (counting from 0) that is not in p. These are
+   reprune() and deprune() of simple_prune. rank() is a binary search over p;
+   select() is one over \f$p_j-j\f$, which does not decrease for distinct
+   numbers: select(N) is N plus the number of j with \f$p_j-j\le N\f$.
+
+   Like memo_index, the index follows its list lazily: a list of a different
+   length causes a rebuild on the next call. Replacing the list by one of the
+   same length must be announced with clear().
+ */
+{
+private:
+   //! \f$p_j-j\f$ for the indexed list.
+   refvector<ulong> shifted;
+   //! Whether shifted belongs to the list.
+   bool built;
+
+   //! Rebuild shifted unless it matches list.
+   void follow(const refvector<ulong>& list)
+   {
+      if(built && shifted.size()==list.size()) return;
+      refvector<ulong> s(list.size());
+      for(long j=0;j<list.size();j++)
+         s[j]=list[j]-j;
+      shifted=s;
+      built=true;
+   }
+
+   //! Number of entries of the ascending list a not larger than N.
+   static long upper_bound(const refvector<ulong>& a, ulong N)
+   {
+      long lo=0, hi=a.size();
+      while(lo<hi) {
+         long mid=lo+(hi-lo)/2;
+         if(a[mid]<=N) lo=mid+1;
+         else hi=mid;
+      }
+      return lo;
+   }
+
+public:
+   rank_select() : built(false) {};
+
+   //! Copy constructor. The copy starts empty and is rebuilt on demand.
+   rank_select(const rank_select& a) : built(false) {};
+
+   //! Assignment. The index is rebuilt on demand.
+   rank_select& operator=(const rank_select& a) { clear(); return *this; }
+
+   //! Forget the indexed list.
+   void clear() { built=false; }
+
+   //! Number of entries of list not larger than N.
+   ulong rank(ulong N, const refvector<ulong>& list) const
+   {
+      return upper_bound(list,N);
+   }
+
+   //! N-th number not in list.
+   ulong select(ulong N, const refvector<ulong>& list)
+   {
+      follow(list);
+      return N+upper_bound(shifted,N);
+   }
+};
+
+#endif
@@ -40,13 +40,45 @@ class reorder_general_base: public pruner_abstract<X>
    mutable refvector < refvector<valerg> > base_averages;
    //! Records the size of visited prior to the latest iteration.
    mutable ulong oldvisitedsize;
+   //! Inverse permutations of base_order: base_order[i][base_inverse[i][j]]==j.
+   mutable refvector < refvector < long > > base_inverse;
+
+   //! Rebuild base_inverse from base_order.
+   void invert() const
+   {
+      refvector < refvector < long > > inv(base_order.size());
+      for(long i=0;i<base_order.size();i++) {
+         refvector<long> r(base_order[i].size());
+         for(long k=0;k<base_order[i].size();k++)
+            r[base_order[i][k]]=k;
+         inv[i]=r;
+      }
+      base_inverse=inv;
+   }
+
+   //! Position of digit j in base_order[i].
+   /*!
+      Equivalent to base_order[i].contains(j). The inverse is checked against
+      base_order on every lookup and rebuilt if the orders have changed, so that
+      prune(), load_state() and copies sharing base_order need not announce it.
+    */
+   long position(long i, long j) const
+   {
+      if(base_inverse.size()!=base_order.size() ||
+            base_inverse[i].size()!=base_order[i].size() ||
+            base_order[i][base_inverse[i][j]]!=j)
+         invert();
+      return base_inverse[i][j];
+   }
 
 public:
 
    using pruner_abstract<X>::visited_r;
+   using pruner_abstract<X>::visited_index;
    using pruner_abstract<X>::value_r;
    using pruner_abstract<X>::prune;
    using pruner_abstract<X>::get_badval;
+   using pruner_abstract<X>::penalty_products;
 
    bool minimax;
    bool at_max;
@@ -97,7 +129,7 @@ public:
    //! Compute the increase of lambda and assess current best value.
    void adjust_lagrange(refvector<double> &oldlambda, ulong & conf1, ulong & conf2, long &config, const refvector<ulong>& visited_run) const
    {
-      config=visited_r.contains(deprune(conf1));
+      config=visited_index(deprune(conf1));
       const ulong conf3=deprune(conf1); // save original
       string serr="reorder_general_base<X>::adjust_lagrange(double& lambda,ulong& conf1,ulong& conf2,long& config)";
       if(config<0)
@@ -115,34 +147,46 @@ public:
          // smallest penalty and largest property.
          try {
             conf1=visited_r[config];
+            // Products of the penalties of the run with both multipliers, see value_columns.
+            // Position k of at holds the memo index of visited_run[k], followed by config and min_max.
+            long n=visited_run.size();
+            vector<long> at(n+2);
+            for(i=0;i<n;i++)
+               at[i]=visited_index(visited_run[i]);
+            const long c=n;
+            long m=n+1;
+            at[c]=config;
+            at[m]=min_max;
+            vector<double> pn, po;
+            penalty_products(newlambda,at,pn);
+            penalty_products(oldlambda,at,po);
 
-            for(i=0;i< visited_run.size() &&
+            for(i=0;i<n &&
             (
-                  (value_r[config].penalty-
-                        value_r[visited_r.contains(visited_run[i])].penalty)*newlambda<1e-16 ||
-                        value_r[visited_r.contains(visited_run[i])].penalty == get_badval().penalty
+                  pn[c]-pn[i]<1e-16 ||
+                        value_r[at[i]].penalty == get_badval().penalty
             )
             ;i++)
             {
-               j=visited_r.contains(visited_run[i]);
+               j=at[i];
                // min
-               if (value_r[min_max].penalty*newlambda>=
-                     value_r[j].penalty*newlambda)
+               if (pn[m]>=pn[i])
                   // max
-                  if (!(value_r[min_max].penalty*newlambda==
-                        value_r[j].penalty*newlambda &&
-                        value_r[min_max].property-value_r[min_max].penalty*oldlambda>=
-                        value_r[j].property-value_r[j].penalty*oldlambda)
-                  )
+                  if (!(pn[m]==pn[i] &&
+                        value_r[min_max].property-po[m]>=
+                        value_r[j].property-po[i])
+                  ) {
                      min_max=j;
+                     m=i;
+                  }
             }
-            if(i< visited_run.size())
+            if(i<n)
             {
-               j=visited_r.contains(visited_run[i]);
-               if(value_r[config].penalty*newlambda>value_r[j].penalty*newlambda)
+               j=at[i];
+               if(pn[c]>pn[i])
                   lambda=
-                        fabs((value_r[config].property-value_r[config].penalty*oldlambda-
-                              (value_r[j].property-value_r[j].penalty*oldlambda))
+                        fabs((value_r[config].property-po[c]-
+                              (value_r[j].property-po[i]))
                               /
                               ((value_r[config].penalty-value_r[j].penalty)*newlambda)
                         );
@@ -150,27 +194,27 @@ public:
                conf1=visited_r[j];
                i++;
             }
-            for(; i< visited_run.size(); i++) {
-               j=visited_r.contains(visited_run[i]);
+            for(; i<n; i++) {
+               j=at[i];
                // min
-               if (value_r[min_max].penalty*newlambda>=
-                     value_r[j].penalty*newlambda)
+               if (pn[m]>=pn[i])
                   // max
-                  if (!(value_r[min_max].penalty*newlambda==
-                        value_r[j].penalty*newlambda &&
-                        value_r[min_max].property-value_r[min_max].penalty*oldlambda>
-                  value_r[j].property-value_r[j].penalty*oldlambda)
-                  )
+                  if (!(pn[m]==pn[i] &&
+                        value_r[min_max].property-po[m]>
+                  value_r[j].property-po[i])
+                  ) {
                      min_max=j;
+                     m=i;
+                  }
 
-               if(fabs(value_r[config].property-value_r[config].penalty*oldlambda-value_r[j].property+value_r[j].penalty*oldlambda)
+               if(fabs(value_r[config].property-po[c]-value_r[j].property+po[i])
                      <
                      ((value_r[config].penalty-value_r[j].penalty)*newlambda)*lambda
                )
                {
                   lambda=
                         fabs(
-                              (value_r[config].property-value_r[config].penalty*oldlambda-value_r[j].property+value_r[j].penalty*oldlambda)
+                              (value_r[config].property-po[c]-value_r[j].property+po[i])
                               /
                               ((value_r[config].penalty-value_r[j].penalty)*newlambda)
                         );
@@ -194,7 +238,7 @@ public:
          //minimize the penalty
          for(i=0;i<visited_run.size();i++)
          {
-            j=visited_r.contains(visited_run[i]);
+            j=visited_index(visited_run[i]);
             // If at least one component is lower
             if(lesseq<double>(value_r[j].penalty,min))
                // Only if ALL components are lower or the property value increases
@@ -234,7 +278,7 @@ public:
       }
       else conf2=deprune(conf2);//keep conf2 as before
 
-      config=visited_r.contains(conf1);
+      config=visited_index(conf1);
    }
 
    //! Adjust the Lagrange multiplier and prune the library.
@@ -269,7 +313,7 @@ public:
          for(i=0;i<visited_run.size();i++)
          {
             ulong N=visited_run[i];
-            long m=visited_r.contains(N);
+            long m=visited_index(N);
             for(j=0;j<base_order.size();j++)
             {
                long k=N % base_order[j].size();
@@ -324,7 +368,7 @@ public:
          }
          oldvisitedsize=visited_run.size();
 
-         config=visited_r.contains(conf1);
+         config=visited_index(conf1);
          conf1=reprune(conf1);
          conf2=reprune(conf2);
 
@@ -344,6 +388,24 @@ public:
       return conf1;
    }
 
+   //! Append the memo and the orders of the bases to a checkpoint.
+   void save_state(checkpoint& c) const
+   {
+      pruner_abstract<X>::save_state(c);
+      c.put(base_order);
+      c.put(base_averages);
+      c.put(oldvisitedsize);
+   }
+
+   //! Restore the state written by save_state().
+   void load_state(checkpoint& c) const
+   {
+      pruner_abstract<X>::load_state(c);
+      c.get(base_order);
+      c.get(base_averages);
+      c.get(oldvisitedsize);
+   }
+
    //! Reverse-map N to the global index.
    ulong deprune (ulong N) const
    {
@@ -372,7 +434,7 @@ public:
       {
          j=conf1 % base_order[i].size();
          conf1=(conf1-j)/base_order[i].size();
-         M+=base_order[i].contains(j)*k;
+         M+=position(i,j)*k;
          k*=(ulong) base_order[i].size();
       }
       conf1=M;
@@ -0,0 +1,177 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file result_cache.cc \brief Implementation of the persistent result cache.
+
+#include <BCR_CPP_LA/refcount.h>
+#include <result_cache.hh>
+#include <iostream>
+#include <string>
+#include <map>
+#include <utility>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace linear_algebra;
+
+int result_cache::fd=-1;
+long result_cache::loaded=0;
+
+//! Records of the cache file by (key, number).
+static map<pair<ulong,ulong>,valerg> records;
+
+//! Parse one record. Returns false on malformed lines.
+static bool parse(const char* line, ulong& key, ulong& number, valerg& val)
+{
+   char* end;
+   const char* p=line;
+   key=strtoul(p,&end,16);
+   if(end==p) return false;
+   p=end;
+   number=strtoul(p,&end,10);
+   if(end==p) return false;
+   p=end;
+   double x[2];
+   long flags[3];
+   for(long i=0;i<2;i++) {
+      x[i]=strtod(p,&end);
+      if(end==p) return false;
+      p=end;
+   }
+   for(long i=0;i<3;i++) {
+      flags[i]=strtol(p,&end,10);
+      if(end==p) return false;
+      p=end;
+   }
+   if(flags[2]<0) return false;
+   val.property=x[0];
+   val.energy=x[1];
+   val.property_computed=flags[0];
+   val.energy_computed=flags[1];
+   val.penalty=penalty_vector(flags[2]);
+   for(long i=0;i<flags[2];i++) {
+      double y=strtod(p,&end);
+      if(end==p) return false;
+      val.penalty[i]=y;
+      p=end;
+   }
+   while(*p==' ') p++;
+   return *p=='\0';
+}
+
+void result_cache::refresh()
+{
+   struct stat st;
+   if(fd<0 || fstat(fd,&st)!=0 || st.st_size<=loaded) return;
+
+   string data;
+   char chunk[65536];
+   off_t pos=loaded;
+   while(pos<st.st_size) {
+      ssize_t r=pread(fd,chunk,sizeof(chunk),pos);
+      if(r<=0) break;
+      data.append(chunk,r);
+      pos+=r;
+   }
+
+   // Only complete lines are consumed; a partial last line is read again later.
+   size_t start=0, nl;
+   while((nl=data.find('\n',start))!=string::npos) {
+      string line=data.substr(start,nl-start);
+      ulong key,number;
+      valerg val;
+      if(parse(line.c_str(),key,number,val))
+         records[make_pair(key,number)]=val;
+      start=nl+1;
+   }
+   loaded+=start;
+}
+
+/*!
+   \param file name of the cache file. It is created if it does not exist.
+ */
+void result_cache::open(const string& file)
+{
+   try {
+      if(fd>=0) close(fd);
+      records.clear();
+      loaded=0;
+      fd=::open(file.c_str(),O_RDWR | O_APPEND | O_CREAT,0644);
+      if(fd<0) throw domain_error("cannot open cache file "+file);
+      refresh();
+      cout << "Result cache " << file << " holds " << records.size() << " values\n";
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by result_cache::open(const string& file)");
+   }
+}
+
+ulong result_cache::hash(const string& s)
+{
+   ulong h=0xcbf29ce484222325UL;
+   for(size_t i=0;i<s.size();i++) {
+      h^=(unsigned char) s[i];
+      h*=0x100000001b3UL;
+   }
+   return h;
+}
+
+/*!
+   \param val is set to the stored value if a record exists.
+ */
+bool result_cache::lookup(ulong key, ulong number, valerg& val)
+{
+   if(fd<0) return false;
+   map<pair<ulong,ulong>,valerg>::const_iterator it=records.find(make_pair(key,number));
+   if(it==records.end()) {
+      refresh();
+      it=records.find(make_pair(key,number));
+      if(it==records.end()) return false;
+   }
+   val=it->second;
+   return true;
+}
+
+void result_cache::store(ulong key, ulong number, const valerg& val)
+{
+   if(fd<0) return;
+   string line;
+   char buf[64];
+   snprintf(buf,sizeof(buf),"%016lx %lu",key,number);
+   line+=buf;
+   snprintf(buf,sizeof(buf)," %.17g %.17g",val.property,val.energy);
+   line+=buf;
+   snprintf(buf,sizeof(buf)," %d %d %ld",(int) val.property_computed,(int) val.energy_computed,(long) val.penalty.size());
+   line+=buf;
+   for(long i=0;i<val.penalty.size();i++) {
+      snprintf(buf,sizeof(buf)," %.17g",val.penalty[i]);
+      line+=buf;
+   }
+   line+="\n";
+
+   // One write per record keeps concurrent appends from interleaving.
+   if(write(fd,line.data(),line.size())!=(ssize_t) line.size())
+      cerr << "result_cache: failed to append a record\n";
+   records[make_pair(key,number)]=val;
+}
@@ -0,0 +1,79 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file result_cache.hh \brief Persistent store of computed values shared across runs.
+
+#ifndef _RESULT_CACHE_HH
+#define _RESULT_CACHE_HH
+
+#include <BCR_CPP_LA/refcount.decl>
+#include <typedefs.hh>
+#include <string>
+
+using namespace linear_algebra;
+using namespace std;
+
+//! Append-only file of computed values, keyed by a library definition and a number.
+class result_cache
+/*!
+   Each record is one line of text holding the key of the library (a hash of its
+   canonical definition), the number within that library and the valerg. Records
+   are appended with a single write() on a descriptor opened with O_APPEND, so
+   several runs, and the children of eval_pool, may share one file. Records that
+   other processes append are picked up when a lookup misses. Truncated or
+   malformed lines, e.g., from a crashed run, are skipped; later records take
+   precedence over earlier ones.
+
+   The key does not cover the external scripts. The cache file has to be removed
+   whenever energy_run or property_script change.
+
+   A conformer energy found in the cache is not computed again, so energy_run
+   does not run for its id. property_script gets id.zmat, which calc_property()
+   writes itself, but must not rely on anything else energy_run leaves behind
+   for the same id: id.energy, id.rconsts, id.rvars and any files of its own,
+   such as output of the quantum chemistry program, may be missing, or be stale
+   from an earlier run in the same directory.
+ */
+{
+private:
+   //! Descriptor of the cache file, -1 if no cache is used.
+   static int fd;
+
+   //! Number of bytes of the file that have been read.
+   static long loaded;
+
+   //! Read records appended to the file since the last call.
+   static void refresh();
+public:
+   //! Use file as cache, creating it if necessary, and load its records.
+   static void open(const string& file);
+
+   //! Whether a cache file is in use.
+   static bool is_open() { return fd>=0; }
+
+   //! Hash of a canonical definition (64 bit FNV-1a).
+   static ulong hash(const string& s);
+
+   //! Look up number in the library with key. Returns false if there is no record.
+   static bool lookup(ulong key, ulong number, valerg& val);
+
+   //! Append the value of number in the library with key.
+   static void store(ulong key, ulong number, const valerg& val);
+};
+
+#endif
@@ -42,40 +42,55 @@ ulong simple_prune<X>::prune(refvector<double>& oldlambda,
       // smallest penalty and largest property.
       long min_max=0;
       ulong conf3=deprune(conf1);
-      config=visited.contains(deprune(conf1));
+      config=visited_index(deprune(conf1));
       if(config<0)
          throw domain_error("simple_prune<X>::prune(refvector<double>& lambda,ulong& conf1,ulong& conf2,long& config: conf1 not contained in visited_run) const");
       conf1=visited[config];
       const refvector<double>& newlambda=value_r[config].penalty;
       double lambda=0.0;
-
-      for(i=0;i< visited_run.size() && (
-            value[config].penalty*newlambda-
-            value[visited_r.contains(visited_run[i])].penalty*newlambda<1e-16 ||
-            value[visited_r.contains(visited_run[i])].penalty*newlambda == INFINITY
+      // Products of the penalties of the run with both multipliers, see value_columns.
+      // Position k of at holds the memo index of visited_run[k], followed by config and min_max.
+      long n=visited_run.size();
+      vector<long> at(n+2);
+      for(i=0;i<n;i++)
+         at[i]=visited_index(visited_run[i]);
+      const long c=n;
+      long m=n+1;
+      at[c]=config;
+      at[m]=min_max;
+      vector<double> pn, po;
+      penalty_products(newlambda,at,pn);
+      penalty_products(oldlambda,at,po);
+      // oldlambda grows by multiples of newlambda below, so its products are po[k]+shift*pn[k].
+      double shift=0.0;
+
+      for(i=0;i<n && (
+            pn[c]-
+            pn[i]<1e-16 ||
+            pn[i] == INFINITY
       )
       ;i++)
       {
-         j=visited_r.contains(visited_run[i]);
+         j=at[i];
          // min
-         if (value[min_max].penalty*newlambda>=
-               value[j].penalty*newlambda)
+         if (pn[m]>=pn[i])
             // max
-            if (!(value[min_max].penalty*newlambda==
-                  value[j].penalty*newlambda &&
-                  value[min_max].property-value[min_max].penalty*oldlambda>=
-                  value[j].property-value[j].penalty*oldlambda)
-            )
+            if (!(pn[m]==pn[i] &&
+                  value[min_max].property-po[m]>=
+                  value[j].property-po[i])
+            ) {
                min_max=j;
+               m=i;
+            }
       }
 
-      if(i< visited_run.size())
+      if(i<n)
       {
-         j=visited_r.contains(visited_run[i]);
-         if(value[config].penalty*newlambda>value[j].penalty*newlambda)
+         j=at[i];
+         if(pn[c]>pn[i])
             lambda=
-                  fabs((value[config].property-value[config].penalty*oldlambda-
-                        value[j].property-value[j].penalty*oldlambda)
+                  fabs((value[config].property-po[c]-
+                        value[j].property-po[i])
                         /
                         ((value[config].penalty-value[j].penalty)*newlambda)
                   );
@@ -83,42 +98,43 @@ ulong simple_prune<X>::prune(refvector<double>& oldlambda,
          conf1=visited_r[j];
       }
       for(;
-            i< visited_run.size(); i++)
+            i<n; i++)
       {
-         j=visited_r.contains(visited_run[i]);
+         j=at[i];
          // min
-         if (value[min_max].penalty*newlambda>=
-               value[j].penalty*newlambda)
+         if (pn[m]>=pn[i])
             // max
-            if (!(value[min_max].penalty*newlambda==
-                  value[j].penalty*newlambda &&
-                  value[min_max].property-value[min_max].penalty*oldlambda>
-            value[j].property-value[j].penalty*oldlambda)
-            )
+            if (!(pn[m]==pn[i] &&
+                  value[min_max].property-(po[m]+shift*pn[m])>
+            value[j].property-(po[i]+shift*pn[i]))
+            ) {
                min_max=j;
+               m=i;
+            }
 
-         if(fabs(value[config].property-value[config].penalty*oldlambda-
-               value[j].property-value[j].penalty*oldlambda)
+         if(fabs(value[config].property-(po[c]+shift*pn[c])-
+               value[j].property-(po[i]+shift*pn[i]))
                <
                ((value[config].penalty-value[j].penalty)*newlambda)*lambda
          )
          {
             lambda=
-                  fabs((value[config].property-value[config].penalty*oldlambda-
-                        value[j].property-value[j].penalty*oldlambda)
+                  fabs((value[config].property-(po[c]+shift*pn[c])-
+                        value[j].property-(po[i]+shift*pn[i]))
                         /
                         ((value[config].penalty-value[j].penalty)*newlambda)
                   );
             conf1=visited_run[i];
          }
          oldlambda+=newlambda*lambda;
+         shift+=lambda;
       }
       if(deprune(conf2)==conf1 && (visited_r[min_max]!=conf1 || conf3!=conf1)) {
          conf2=visited_r[min_max];
       }
       else conf2=deprune(conf2);
 
-      config=visited_r.contains(conf1);
+      config=visited_index(conf1);
 
       // Lambda has been discerned and conf1 is the index in the global library
 
@@ -126,8 +142,10 @@ ulong simple_prune<X>::prune(refvector<double>& oldlambda,
       // Compute the pruned library
 
       refvector<ulong> dummy;
-      for(i=0;i<visited_run.size();i++)
-         if(value[config].penalty*oldlambda<value[visited_r.contains(visited_run[i])].penalty*oldlambda)
+      at[c]=config;
+      penalty_products(oldlambda,at,po);
+      for(i=0;i<n;i++)
+         if(po[c]<po[i])
             dummy.push_back(visited_run[i]);
 
       refvector<unsigned long> dummy_index;
@@ -140,21 +158,18 @@ ulong simple_prune<X>::prune(refvector<double>& oldlambda,
       pruned_visited->resize(dummy.size());
       for(i=0;i<dummy.size();i++)
          pruned_visited[i]=dummy[dummy_index[i]];
+      pruned_index.clear();
 
       // Pruned indices determined
       conf3=conf1;
 
       // Compute pruned index conf1, conf2
-      for(i=pruned_visited.size()-1;i>=0;i--)
-         if(conf1>=pruned_visited[i])
-            conf1--;
-      for(i=pruned_visited.size()-1;i>=0;i--)
-         if(conf2>=pruned_visited[i])
-            conf2--;
+      conf1=reprune(conf1);
+      conf2=reprune(conf2);
 
       if(deprune(conf1)!=conf3)
          throw domain_error("prune something wrong in deprune/prune");
-      config=visited_r.contains(conf3);
+      config=visited_index(conf3);
 
       space_size_computed=false;
       bits_computed=false;
@@ -170,26 +185,19 @@ ulong simple_prune<X>::prune(refvector<double>& oldlambda,
    }
       }
 
+/*!
+   pruned_visited is ascending and holds distinct numbers, since the runs
+   it is computed from do.
+ */
 template <class X>
 ulong simple_prune<X>::deprune(ulong N) const
 {
-   ulong i=N;
-   for(long j=0;j<pruned_visited.size();j++)
-      if(i>=pruned_visited[j])
-      {
-         i++;
-      }
-   return i;
+   return pruned_index.select(N,pruned_visited);
 }
 
 
 template <class X>
 ulong simple_prune<X>::reprune(ulong N) const
 {
-   ulong i;
-   ulong conf1=N;
-   for(i=pruned_visited.size();i>=1;i--)
-      if(conf1>=pruned_visited[i-1])
-         conf1--;
-   return conf1;
+   return N-pruned_index.rank(N,pruned_visited);
 }
@@ -38,6 +38,7 @@ protected:
    using pruner_abstract<X>::value;
    using pruner_abstract<X>::visited;
    using pruner_abstract<X>::pruned_visited;
+   using pruner_abstract<X>::pruned_index;
    using X::bits_computed;
    using X::space_size_computed;
 
@@ -45,7 +46,10 @@ public:
 
    using pruner_abstract<X>::value_r;
    using pruner_abstract<X>::visited_r;
+   using pruner_abstract<X>::visited_index;
    using pruner_abstract<X>::prune;
+   using pruner_abstract<X>::penalty_products;
+   using pruner_abstract<X>::penalty_product;
 
    simple_prune() : pruner_abstract<X>() {};
    simple_prune(const simple_prune<X>& a) :
@@ -53,9 +57,9 @@ public:
       {};
    //! Prune the Library and adjust lambda. Pruned entries are in pruned_visited.
    ulong prune(refvector<double> &lambda, ulong &conf1, ulong &conf2, long &config, const refvector<ulong>& a) const;
-   //! Revert an index from the pruned Library to the original Library
+   //! Revert an index from the pruned Library to the original Library. O(log n) in the number of pruned entries.
    ulong deprune(ulong N) const;
-   //! Convert an "absolute" index to a relative index.
+   //! Convert an "absolute" index to a relative index. O(log n) in the number of pruned entries.
    ulong reprune(ulong N) const;
 protected:
 
@@ -0,0 +1,363 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file synthetic_landscape.cc \brief Implementation of the synthetic landscapes.
+
+#include <BCR_CPP_LA/refcount.h>
+#include <synthetic_landscape.hh>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace linear_algebra;
+
+long synthetic_landscape::type=0;
+long synthetic_landscape::parameter=0;
+ulong synthetic_landscape::seed=1;
+string synthetic_landscape::spec="";
+
+//! Statistics for the report at exit.
+static long evaluations=0;
+static char spec_buffer[256]="";
+static long best_at=0;
+static double best=-INFINITY;
+static double evaluation_time=0.0;
+static double start_time=0.0;
+static double library_size=0.0;
+//! Feasible optimum, computed with the first evaluation for libraries of at most 2^22 molecules.
+static double optimum=-INFINITY;
+static bool optimum_known=false;
+
+//! Monotonic time in seconds.
+static double now()
+{
+   struct timespec t;
+   clock_gettime(CLOCK_MONOTONIC,&t);
+   return t.tv_sec+1e-9*t.tv_nsec;
+}
+
+//! splitmix64 step.
+static ulong mix(ulong k)
+{
+   k+=0x9e3779b97f4a7c15UL;
+   k=(k^(k >> 30))*0xbf58476d1ce4e5b9UL;
+   k=(k^(k >> 27))*0x94d049bb133111ebUL;
+   return k^(k >> 31);
+}
+
+//! Whether all penalties vanish.
+static bool feasible(const valerg& val)
+{
+   for(long k=0;k<val.penalty.size();k++)
+      if(val.penalty[k]>0.0) return false;
+   return true;
+}
+
+double synthetic_landscape::uniform(ulong a, ulong b, ulong c, ulong d)
+{
+   ulong h=mix(seed);
+   h=mix(h^a);
+   h=mix(h^b);
+   h=mix(h^c);
+   h=mix(h^d);
+   return (h >> 11)*(1.0/9007199254740992.0);
+}
+
+/*!
+   \param specification <type>[:<parameter>][\@<seed>] with type additive, nk or rugged.
+ */
+void synthetic_landscape::configure(const string& specification)
+{
+   try {
+      string s=specification;
+      seed=1;
+      size_t at=s.find('@');
+      if(at!=string::npos) {
+         stringstream ss(s.substr(at+1));
+         ss >> seed;
+         s=s.substr(0,at);
+      }
+      string name=s;
+      parameter=-1;
+      size_t colon=s.find(':');
+      if(colon!=string::npos) {
+         name=s.substr(0,colon);
+         stringstream ss(s.substr(colon+1));
+         ss >> parameter;
+      }
+      if(name=="additive") type=1;
+      else if(name=="nk" || name=="NK") {
+         type=2;
+         if(parameter<0) parameter=2;
+      }
+      else if(name=="rugged") {
+         type=3;
+         if(parameter<1) parameter=8;
+      }
+      else
+         throw domain_error("Unknown synthetic landscape "+name);
+      spec=specification;
+      snprintf(spec_buffer,sizeof(spec_buffer),"%s",spec.c_str());
+      start_time=now();
+      atexit(report);
+      signal(SIGTERM,interrupted);
+      cout << "Synthetic landscape: " << spec << endl;
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by synthetic_landscape::configure(const string& specification)");
+   }
+}
+
+valerg synthetic_landscape::landscape(const refvector<long>& radices, const refvector<long>& d, long nconstraints)
+{
+   long n=d.size();
+   double p=0.0;
+   if(type==1) {
+      for(long s=0;s<n;s++)
+         p+=10.0*uniform(1,s,d[s]);
+   }
+   else if(type==2) {
+      long K=(parameter<n) ? parameter : n-1;
+      for(long s=0;s<n;s++) {
+         ulong key=d[s];
+         for(long k=1;k<=K;k++)
+            key=mix(key)^d[(s+k)%n];
+         p+=10.0*uniform(2,s,key);
+      }
+   }
+   else {
+      double top=0.0;
+      for(long m=0;m<parameter;m++) {
+         long differ=0;
+         for(long s=0;s<n;s++)
+            if(d[s]!=(long) (uniform(3,m,s)*radices[s])) differ++;
+         double height=(m==0) ? 1.0 : 0.5+0.5*uniform(4,m);
+         double x=(n>0) ? 1.0-(double) differ/n : 1.0;
+         if(height*x*x>top) top=height*x*x;
+      }
+      p=10.0*n*top;
+      for(long s=0;s<n;s++)
+         p+=uniform(5,s,d[s]);
+   }
+
+   valerg val;
+   val.property=p;
+   val.energy=-p;
+   val.property_computed=true;
+   val.energy_computed=true;
+   val.penalty=penalty_vector(nconstraints);
+   for(long k=0;k<nconstraints;k++) {
+      double load=0.0;
+      for(long s=0;s<n;s++)
+         load+=uniform(100+k,s,d[s]);
+      val.penalty[k]=(load>0.5*n) ? load-0.5*n : 0.0;
+   }
+   return val;
+}
+
+/*!
+   \param radices of the library, see ChemGroup::get_radices().
+   \param d digits of the molecule, see ChemGroup::get_digits().
+   \param nconstraints number of penalties.
+ */
+valerg synthetic_landscape::evaluate(const refvector<long>& radices, const refvector<long>& d, long nconstraints)
+{
+   if(evaluations==0) {
+      library_size=1.0;
+      for(long s=0;s<radices.size();s++)
+         library_size*=radices[s];
+      if(library_size<=4194304.0) {
+         // The enumeration is not part of the optimization it measures.
+         double t=now();
+         refvector<long> e(radices.size());
+         e.zero();
+         for(ulong i=0;i<(ulong) library_size;i++) {
+            valerg val=landscape(radices,e,nconstraints);
+            if(feasible(val) && val.property>optimum) optimum=val.property;
+            for(long s=0;s<e.size();s++) {
+               if(++e[s]<radices[s]) break;
+               e[s]=0;
+            }
+         }
+         optimum_known=true;
+         start_time+=now()-t;
+      }
+   }
+   double t=now();
+   valerg val=landscape(radices,d,nconstraints);
+   evaluation_time+=now()-t;
+   evaluations++;
+   if(feasible(val) && val.property>best) {
+      best=val.property;
+      best_at=evaluations;
+   }
+   return val;
+}
+
+/*!
+   The child's own statistics are lost when it exits, hence the parent
+   counts the values it merges into its memo. Their evaluation time is not known.
+ */
+void synthetic_landscape::record(const valerg& val)
+{
+   evaluations++;
+   if(feasible(val) && val.property>best) {
+      best=val.property;
+      best_at=evaluations;
+   }
+}
+
+//! Append the text s at p, but not beyond end.
+static void put(char*& p, char* end, const char* s)
+{
+   while(*s!='\0' && p<end) *p++=*s++;
+}
+
+//! Append the decimal digits of v at p, but not beyond end.
+static void put(char*& p, char* end, unsigned long v)
+{
+   char d[24];
+   int k=0;
+   do {
+      d[k++]='0'+v%10;
+      v/=10;
+   } while(v>0);
+   while(k>0 && p<end) *p++=d[--k];
+}
+
+static void put(char*& p, char* end, long v)
+{
+   if(v<0) put(p,end,"-");
+   put(p,end,(v<0) ? 0UL-(unsigned long) v : (unsigned long) v);
+}
+
+//! Append x with at most the given number of decimals at p, in exponent form from 1e15 on.
+static void put(char*& p, char* end, double x, int decimals)
+{
+   if(x!=x) {
+      put(p,end,"nan");
+      return;
+   }
+   if(x<0.0) {
+      put(p,end,"-");
+      x=-x;
+   }
+   if(x>1.7976931348623157e308) {
+      put(p,end,"inf");
+      return;
+   }
+   long exponent=0;
+   while(x>=1e15) {
+      x/=10.0;
+      exponent++;
+   }
+   unsigned long scale=1;
+   for(int i=0;i<decimals;i++) scale*=10;
+   unsigned long whole=(unsigned long) x;
+   unsigned long fraction=(unsigned long) ((x-whole)*scale+0.5);
+   if(fraction>=scale) {
+      whole++;
+      fraction-=scale;
+   }
+   put(p,end,whole);
+   if(fraction>0) {
+      char d[24];
+      int k=decimals;
+      while(k>0 && fraction%10==0) {
+         fraction/=10;
+         k--;
+      }
+      for(int i=k-1;i>=0;i--) {
+         d[i]='0'+fraction%10;
+         fraction/=10;
+      }
+      d[k]='\0';
+      put(p,end,".");
+      put(p,end,d);
+   }
+   if(exponent>0) {
+      put(p,end,"e+");
+      put(p,end,exponent);
+   }
+}
+
+/*!
+   Formats with async-signal-safe code only, without stdio or allocation,
+   so that it may be called from the SIGTERM handler.
+ */
+void synthetic_landscape::statistics(char* buffer, size_t n, const char* suffix)
+{
+   if(n==0) return;
+   char* p=buffer;
+   char* end=buffer+n-1;
+   double wall=now()-start_time;
+   put(p,end,"Synthetic benchmark: landscape ");
+   put(p,end,spec_buffer);
+   put(p,end," size ");
+   put(p,end,library_size,0);
+   put(p,end," evaluations ");
+   put(p,end,evaluations);
+   put(p,end," best ");
+   put(p,end,best,6);
+   put(p,end," found_at ");
+   put(p,end,best_at);
+   if(optimum_known) {
+      put(p,end," optimum ");
+      put(p,end,optimum,6);
+      put(p,end," reached ");
+      put(p,end,(best>=optimum) ? "yes" : "no");
+   }
+   put(p,end," wall_time ");
+   put(p,end,wall,6);
+   put(p,end," evaluation_time ");
+   put(p,end,evaluation_time,6);
+   put(p,end," overhead ");
+   put(p,end,wall-evaluation_time,6);
+   put(p,end,suffix);
+   put(p,end,"\n");
+   *p='\0';
+}
+
+void synthetic_landscape::report()
+{
+   char buffer[1024];
+   statistics(buffer,sizeof(buffer),"");
+   cout << buffer;
+   cout.flush();
+}
+
+/*!
+   Some optimizers do not terminate on every landscape, hence the benchmark
+   stops them with SIGTERM and still needs the statistics.
+ */
+void synthetic_landscape::interrupted(int signal)
+{
+   char buffer[1024];
+   statistics(buffer,sizeof(buffer)," interrupted");
+   if(write(1,buffer,strlen(buffer))<0) _exit(1);
+   _exit(124);
+}
@@ -0,0 +1,102 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file synthetic_landscape.hh \brief Analytic test functions over the library numbering.
+
+#ifndef _SYNTHETIC_LANDSCAPE_HH
+#define _SYNTHETIC_LANDSCAPE_HH
+
+#include <BCR_CPP_LA/refcount.decl>
+#include <typedefs.hh>
+#include <string>
+
+using namespace linear_algebra;
+using namespace std;
+
+//! Synthetic property landscapes replacing the conformational analysis (--synthetic).
+class synthetic_landscape
+/*!
+   The property of a molecule is computed from the mixed-radix digits of its
+   library number (ChemGroup::get_digits()), i.e., the substituent chosen at
+   each site. This allows measuring how many evaluations the optimizers need
+   on a given library shape without running any external computation.
+
+   The landscape is selected by a specification <type>[:<parameter>][\@<seed>]:
+   - <EM>additive</EM>: every site contributes a value depending on its substituent (group contributions).
+   - <EM>nk[:K]</EM>: the contribution of a site also depends on the substituents at the K following sites
+   (NK landscape, default K=2).
+   - <EM>rugged[:M]</EM>: M peaks (default 8) at random molecules whose height decays with the number of
+   sites differing from the peak, on top of small group contributions.
+
+   Each constraint k sums further random group contributions and penalizes
+   the amount by which the sum exceeds half the number of sites, so that
+   roughly half of the library is feasible. All values are derived from the
+   seed by hashing and do not touch the random() state of the optimizers.
+
+   At exit, the number of evaluations, the evaluation after which the best
+   feasible value was found, the feasible optimum (enumerated before the
+   first evaluation if the library has at most 2^22 molecules) and the wall
+   and evaluation times are printed in a line starting with "Synthetic
+   benchmark:". The line is also printed, ending in "interrupted", when the
+   optimizer is stopped by SIGTERM.
+ */
+{
+private:
+   //! 0 if inactive, otherwise 1 additive, 2 nk, 3 rugged.
+   static long type;
+
+   //! K for nk, M for rugged.
+   static long parameter;
+
+   static ulong seed;
+
+   //! The specification as given.
+   static string spec;
+
+   //! Uniform number in [0,1) derived from the seed and up to three keys.
+   static double uniform(ulong a, ulong b, ulong c=0, ulong d=0);
+
+   //! Value for the digits d of a library with the given radices.
+   static valerg landscape(const refvector<long>& radices, const refvector<long>& d, long nconstraints);
+
+   //! Write the line of statistics ending in suffix to buffer.
+   static void statistics(char* buffer, size_t n, const char* suffix);
+
+   //! Print the statistics at exit.
+   static void report();
+
+   //! Print the statistics and exit on SIGTERM.
+   static void interrupted(int signal);
+public:
+   //! Select a landscape by its specification. Throws on unknown types.
+   static void configure(const string& specification);
+
+   //! Whether the synthetic landscape replaces the conformational analysis.
+   static bool is_active() { return type!=0; }
+
+   //! Specification of the landscape, for the result_cache definition.
+   static string get_spec() { return spec; }
+
+   //! Property and penalties of a molecule given by its digits.
+   static valerg evaluate(const refvector<long>& radices, const refvector<long>& d, long nconstraints);
+
+   //! Count a value that was evaluated in a child process, see run_local_searches().
+   static void record(const valerg& val);
+};
+
+#endif
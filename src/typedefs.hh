@@ -24,12 +24,18 @@
 #include <cmath>
 #include <limits>
 #include <BCR_CPP_LA/refcount.decl>
+#include <penalty_vector.hh>
 
 
 typedef unsigned long ulong;
 
 //! Collects property value, constraint violations, and energy.
-typedef struct { double property; linear_algebra::refvector<double> penalty; double energy; bool property_computed; bool energy_computed;} valerg;
+/*!
+   Up to DCCSO_INLINE_CONSTRAINTS penalties are stored inline (see
+   penalty_vector), so that copying a valerg and the arithmetic below do not
+   allocate.
+ */
+typedef struct { double property; penalty_vector penalty; double energy; bool property_computed; bool energy_computed;} valerg;
 
 //! Pair of configurational and conformational index, respectively.
 typedef struct { int configuration; int conformation;} double_index;
@@ -46,18 +52,7 @@ inline bool operator==(const valerg& a, const valerg& b) {
 }
 
 //! Subtract two valerg.
-inline valerg operator-(const valerg& a, const valerg& b)
-{
-   valerg r;
-   r.property=a.property-b.property;
-   r.energy=a.energy-b.energy;
-   r.penalty=a.penalty-b.penalty;
-   r.property_computed=a.property_computed && b.property_computed;
-   r.energy_computed=a.energy_computed && b.energy_computed;
-   return r;
-}
-//! Subtract two valerg.
-inline valerg operator-=(valerg& a, const valerg& b)
+inline valerg& operator-=(valerg& a, const valerg& b)
       {
    a.property-=b.property;
    a.energy-=b.energy;
@@ -66,8 +61,8 @@ inline valerg operator-=(valerg& a, const valerg& b)
    a.energy_computed=a.energy_computed && b.energy_computed;
    return a;
       }
-//! Subtract two valerg.
-inline valerg operator+=(valerg& a, const valerg& b)
+//! Add two valerg.
+inline valerg& operator+=(valerg& a, const valerg& b)
       {
    a.property+=b.property;
    a.energy+=b.energy;
@@ -77,30 +72,20 @@ inline valerg operator+=(valerg& a, const valerg& b)
    return a;
       }
 
-//! Add two valerg.
-inline valerg operator+(const valerg& a, const valerg& b)
+//! Subtract two valerg. a is taken by value and becomes the result.
+inline valerg operator-(valerg a, const valerg& b)
 {
-   valerg r;
-   r.property=a.property+b.property;
-   r.energy=a.energy+b.energy;
-   r.penalty=a.penalty+b.penalty;
-   r.property_computed=a.property_computed && b.property_computed;
-   r.energy_computed=a.energy_computed && b.energy_computed;
-   return r;
+   a-=b;
+   return a;
 }
 
-//! Multiply
-inline valerg operator*(const valerg& a, const double b)
+//! Add two valerg. a is taken by value and becomes the result.
+inline valerg operator+(valerg a, const valerg& b)
 {
-   valerg r;
-   r=a;
-   r.property*=b;
-   r.penalty*=b;
-   r.energy*=b;
-   r.energy_computed=a.energy_computed;
-   r.property_computed=a.property_computed;
-   return r;
+   a+=b;
+   return a;
 }
+
 //! Multiply
 inline valerg& operator*=(valerg& r, const double b)
       {
@@ -109,6 +94,12 @@ inline valerg& operator*=(valerg& r, const double b)
    r.energy*=b;
    return r;
       }
+//! Multiply
+inline valerg operator*(valerg a, const double b)
+{
+   a*=b;
+   return a;
+}
 
 using namespace linear_algebra;
 
@@ -127,13 +118,12 @@ inline refvector<double> tan(const refvector<double>& l)
    return r;
       }
 
-inline valerg atan(const valerg& a)
+inline valerg atan(valerg a)
 {
-   valerg r=a;
-   r.property=atan(a.property);
-   r.penalty=atan(a.penalty);
-   r.energy=atan(a.energy);
-   return r;
+   a.property=atan(a.property);
+   a.penalty=atan(a.penalty);
+   a.energy=atan(a.energy);
+   return a;
 }
 static const refvector<double> BADPENALTY=refvector<double>();
 
@@ -0,0 +1,202 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file value_columns.hh \brief Columnar copy of the memoized values of a Library.
+
+#ifndef _VALUE_COLUMNS_HH
+#define _VALUE_COLUMNS_HH
+
+#include <BCR_CPP_LA/refcount.decl>
+#include <typedefs.hh>
+#include <vector>
+
+using namespace std;
+using namespace linear_algebra;
+
+//! Structure of arrays holding the entries of Library_data::value.
+class value_columns
+/*!
+   Properties, energies and flags are kept in contiguous arrays and the
+   penalties in a row-major matrix with one row per entry, so that scans
+   over the whole memo (Lagrangians, dot products of penalties with lambda)
+   run over contiguous memory instead of one heap buffer per valerg.
+
+   Like memo_index, the columns follow the list lazily: entries appended to
+   it are copied on the next access and a shrunken list causes a rebuild.
+   Changes of existing entries must be announced with set() or erase(), a
+   wholesale replacement with clear(). If the entries do not all have the
+   same number of penalties, uniform() is false and the matrix is not kept.
+ */
+{
+private:
+   vector<double> property;
+   vector<double> energy;
+   //! Bit 0: property_computed, bit 1: energy_computed.
+   vector<char> flags;
+   //! Penalties, row-major with width columns.
+   vector<double> penalty;
+   long width;
+   bool regular;
+
+   //! Append one entry.
+   void append(const valerg& val)
+   {
+      if(property.size()==0) {
+         width=val.penalty.size();
+         regular=true;
+      }
+      property.push_back(val.property);
+      energy.push_back(val.energy);
+      flags.push_back((val.property_computed ? 1 : 0) | (val.energy_computed ? 2 : 0));
+      if(!regular) return;
+      if(val.penalty.size()!=width) {
+         regular=false;
+         penalty.clear();
+         return;
+      }
+      for(long c=0;c<width;c++)
+         penalty.push_back(val.penalty[c]);
+   }
+
+   void reset()
+   {
+      property.clear();
+      energy.clear();
+      flags.clear();
+      penalty.clear();
+      width=0;
+      regular=true;
+   }
+
+public:
+   value_columns() : width(0), regular(true) {};
+
+   //! Copy constructor. The copy starts empty and is rebuilt on demand.
+   value_columns(const value_columns& a) : width(0), regular(true) {};
+
+   //! Assignment. The columns are rebuilt on demand.
+   value_columns& operator=(const value_columns& a) { clear(); return *this; }
+
+   //! Forget all entries.
+   void clear()
+   {
+      reset();
+   }
+
+   //! Copy the entries appended to list since the last call.
+   void follow(const refvector<valerg>& list)
+   {
+      if((long) property.size()>list.size()) reset();
+      for(long j=property.size();j<list.size();j++)
+         append(list[j]);
+   }
+
+   //! Entry j of the list has changed to val.
+   void set(long j, const valerg& val)
+   {
+      if(j<(long) property.size()) {
+         property[j]=val.property;
+         energy[j]=val.energy;
+         flags[j]=(val.property_computed ? 1 : 0) | (val.energy_computed ? 2 : 0);
+         if(regular && val.penalty.size()!=width) {
+            regular=false;
+            penalty.clear();
+         }
+         if(regular)
+            for(long c=0;c<width;c++)
+               penalty[j*width+c]=val.penalty[c];
+      }
+   }
+
+   //! Entry j has been removed from the list.
+   void erase(long j)
+   {
+      if(j<(long) property.size()) {
+         property.erase(property.begin()+j);
+         energy.erase(energy.begin()+j);
+         flags.erase(flags.begin()+j);
+         if(regular)
+            penalty.erase(penalty.begin()+j*width,penalty.begin()+(j+1)*width);
+      }
+   }
+
+   //! Whether all entries have the same number of penalties.
+   bool uniform() const { return regular; }
+
+   //! Number of entries.
+   long rows() const { return property.size(); }
+
+   //! Number of penalties per entry.
+   long constraints() const { return width; }
+
+   //! \f$\pi_j\cdot\lambda\f$ of the entries j=at[k], in the order of at. Requires uniform() and lambda of the width of the rows.
+   void products(const refvector<double>& lambda, const vector<long>& at, vector<double>& out) const
+   {
+      long n=at.size();
+      out.resize(n);
+      vector<double> l(width);
+      for(long c=0;c<width;c++) l[c]=lambda[c];
+      for(long k=0;k<n;k++) {
+         const double* p=&penalty[0]+at[k]*width;
+         double s=0.0;
+         for(long c=0;c<width;c++)
+            s+=p[c]*l[c];
+         out[k]=s;
+      }
+   }
+
+   //! \f$\pi_j\cdot\lambda\f$ of entry j. Requires uniform().
+   double product(long j, const refvector<double>& lambda) const
+   {
+      double s=0.0;
+      for(long c=0;c<width;c++)
+         s+=penalty[j*width+c]*lambda[c];
+      return s;
+   }
+
+   //! Entry with the smallest \f$|\pi|^2\f$ and, among equal penalties, the largest property. Requires uniform().
+   /*!
+      This is the final selection of the meta-optimizers: an entry replaces
+      the best one if its squared penalty is not larger and either its
+      penalties differ or its property is larger.
+      \return the position of the entry, 0 for an empty list.
+    */
+   long best() const
+   {
+      long n=property.size();
+      vector<double> norm(n);
+      for(long j=0;j<n;j++) {
+         double s=0.0;
+         for(long c=0;c<width;c++)
+            s+=penalty[j*width+c]*penalty[j*width+c];
+         norm[j]=s;
+      }
+      long b=0;
+      for(long j=0;j<n;j++) {
+         if(!(norm[j]<=norm[b])) continue;
+         bool equal=true;
+         for(long c=0;c<width && equal;c++)
+            equal=penalty[j*width+c]==penalty[b*width+c];
+         if(!equal || property[j]>property[b])
+            b=j;
+      }
+      return b;
+   }
+};
+
+#endif
@@ -0,0 +1,365 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file worker_pool.cc \brief Implementation of the worker pool.
+
+#include <BCR_CPP_LA/refcount.h>
+#include <worker_pool.hh>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <stdexcept>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+using namespace std;
+using namespace linear_algebra;
+
+string worker_pool::command="";
+bool worker_pool::per_request=false;
+long worker_pool::slot=0;
+
+//! Per worker: process id, pipe to its stdin, pipe from its stdout, unread output.
+static vector<pid_t> pids;
+//! Per worker: the process that started it, which alone can wait for it.
+static vector<pid_t> owners;
+static vector<int> to_worker;
+static vector<int> from_worker;
+static vector<string> unread;
+
+//! Write all of s to fd. Returns false on failure.
+static bool write_all(int fd, const string& s)
+{
+   size_t done=0;
+   while(done<s.size()) {
+      ssize_t k=write(fd,s.data()+done,s.size()-done);
+      if(k<=0) return false;
+      done+=k;
+   }
+   return true;
+}
+
+//! Read one line from fd into line, keeping surplus bytes in buffer. Returns false on EOF.
+static bool read_line(int fd, string& buffer, string& line)
+{
+   size_t nl;
+   while((nl=buffer.find('\n'))==string::npos) {
+      char chunk[4096];
+      ssize_t r=read(fd,chunk,sizeof(chunk));
+      if(r<=0) return false;
+      buffer.append(chunk,r);
+   }
+   line=buffer.substr(0,nl);
+   buffer.erase(0,nl+1);
+   return true;
+}
+
+//! Read one number. inf and -inf are accepted, NaN and other text are not.
+static bool read_number(istream& in, double& x)
+{
+   string s;
+   if(!(in >> s)) return false;
+   char* end;
+   x=strtod(s.c_str(),&end);
+   return *end=='\0' && end!=s.c_str() && !isnan(x);
+}
+
+//! Read a count followed by that many numbers.
+static bool read_list(istream& in, refvector<double>& v)
+{
+   long n;
+   if(!(in >> n) || n<0) return false;
+   v=refvector<double>(n);
+   for(long i=0;i<n;i++)
+      if(!read_number(in,v[i])) return false;
+   return true;
+}
+
+//! Read a RESULT line for id into r. Returns false if line is none; r.status is -1 if it is incomplete or holds NaN.
+static bool parse_result(const string& line, const string& id, worker_result& r)
+{
+   stringstream s(line);
+   string tag, rid;
+   if(!(s >> tag >> rid >> r.status) || tag!="RESULT" || rid!=id)
+      return false;
+   if(r.status!=0) return true;
+
+   if(!read_number(s,r.property) ||
+         !read_number(s,r.energy) ||
+         !read_list(s,r.penalty) ||
+         !read_list(s,r.consts) ||
+         !read_list(s,r.vars)) {
+      cerr << "worker_pool: incomplete or invalid result \"" << line << "\"" << endl;
+      r.status=-1;
+   }
+   return true;
+}
+
+//! Whether the value that a request of kind asks for is finite. parse_result() has rejected NaN already.
+static bool acceptable(const string& kind, const string& id, worker_result& r)
+{
+   bool ok=isfinite(kind=="energy" ? r.energy : r.property);
+   if(!ok) {
+      cerr << "worker_pool: " << kind << " of " << id << " is not finite, counted as failed" << endl;
+      r.status=-1;
+   }
+   return ok;
+}
+
+void worker_pool::spawn(long k)
+{
+   int in[2], out[2];
+   if(pipe(in)!=0 || pipe(out)!=0)
+      throw domain_error("worker_pool::spawn(long k): pipe() failed");
+   cout.flush();
+   cerr.flush();
+   pid_t pid=fork();
+   if(pid<0) throw domain_error("worker_pool::spawn(long k): fork() failed");
+   if(pid==0) {
+      dup2(in[0],0);
+      dup2(out[1],1);
+      close(in[0]); close(in[1]);
+      close(out[0]); close(out[1]);
+      stringstream s;
+      s << k;
+      setenv("DCCSO_WORKER",s.str().c_str(),1);
+      execl("/bin/sh","sh","-c",command.c_str(),(char*) NULL);
+      _exit(127);
+   }
+   close(in[0]);
+   close(out[1]);
+   fcntl(in[1],F_SETFD,FD_CLOEXEC);
+   fcntl(out[0],F_SETFD,FD_CLOEXEC);
+   pids[k]=pid;
+   owners[k]=getpid();
+   to_worker[k]=in[1];
+   from_worker[k]=out[0];
+   unread[k]="";
+}
+
+/*!
+   A worker started by another process is only killed; that process reaps it
+   and starts its replacement in check().
+ */
+void worker_pool::discard(long k)
+{
+   if(pids[k]<=0) return;
+   close(to_worker[k]);
+   close(from_worker[k]);
+   kill(pids[k],SIGTERM);
+   if(owners[k]==getpid())
+      waitpid(pids[k],NULL,0);
+   pids[k]=0;
+}
+
+/*!
+   Workers run as children of the process that called start(), but requests
+   are mostly sent from children of eval_pool, which cannot pass a restarted
+   worker back. eval_pool therefore calls check() before it forks, so that
+   every batch starts with live workers.
+ */
+void worker_pool::check()
+{
+   try {
+      if(per_request) return;
+      for(long k=0;k<(long) pids.size();k++) {
+         if(pids[k]<=0 || owners[k]!=getpid()) continue;
+         if(waitpid(pids[k],NULL,WNOHANG)!=pids[k]) continue;
+         cerr << "worker_pool: worker " << k << " exited, restarting it" << endl;
+         close(to_worker[k]);
+         close(from_worker[k]);
+         pids[k]=0;
+         spawn(k);
+      }
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by worker_pool::check()");
+   }
+}
+
+/*!
+   \param cmd is passed to /bin/sh -c.
+   \param n number of workers, usually the number of eval_pool slots.
+ */
+void worker_pool::start(const string& cmd, long n)
+{
+   try {
+      stop();
+      command=cmd;
+      per_request=false;
+      if(n<1) n=1;
+      // A worker that exits must not kill the optimizer while it writes a request.
+      signal(SIGPIPE,SIG_IGN);
+      pids.assign(n,0);
+      owners.assign(n,0);
+      to_worker.assign(n,-1);
+      from_worker.assign(n,-1);
+      unread.assign(n,"");
+      for(long k=0;k<n;k++)
+         spawn(k);
+      atexit(stop);
+      cout << "Started " << n << " workers: " << command << endl;
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by worker_pool::start(const string& cmd, long n)");
+   }
+}
+
+/*!
+   \param cmd is passed to /bin/sh -c, followed by the kind and id of the request.
+ */
+void worker_pool::start_per_request(const string& cmd)
+{
+   stop();
+   command=cmd;
+   per_request=true;
+   // A process that exits without reading the Z-matrix must not kill the optimizer.
+   signal(SIGPIPE,SIG_IGN);
+   cout << "Running per request: " << command << endl;
+}
+
+/*!
+   A worker that dies or violates the protocol is replaced and the request is
+   sent once more to the new worker, since the cause is often the worker
+   rather than the molecule. In a child of eval_pool the replacement serves
+   the rest of that child only; the process that owns the pool restarts the
+   worker for good in check().
+
+   A result whose requested value is not finite is treated as a failed
+   evaluation.
+   \param kind is energy or property.
+   \param out is the Z-matrix, as it would be written to the .zmat file.
+   \param id identifies the request, as the file prefix does for the scripts.
+   \param r receives the result.
+ */
+bool worker_pool::request(const string& kind, const string& out, const string& id, worker_result& r)
+{
+   try {
+      r.status=-1;
+      if(per_request)
+         return run_once(kind,out,id,r) && acceptable(kind,id,r);
+      long k=slot % (long) pids.size();
+
+      string body=out+"\n";
+      long nlines=0;
+      for(size_t i=0;i<body.size();i++)
+         if(body[i]=='\n') nlines++;
+      stringstream header;
+      header << "EVAL " << kind << " " << id << " " << nlines << "\n";
+
+      for(long attempt=0;attempt<2;attempt++) {
+         if(pids[k]<=0) spawn(k);
+         string line;
+         if(!write_all(to_worker[k],header.str()+body) ||
+               !read_line(from_worker[k],unread[k],line)) {
+            cerr << "worker_pool: worker " << k << " died while computing " << id << endl;
+            discard(k);
+            continue;
+         }
+         if(!parse_result(line,id,r)) {
+            cerr << "worker_pool: worker " << k << " sent \"" << line << "\" for " << id << endl;
+            discard(k);
+            continue;
+         }
+         return r.status==0 && acceptable(kind,id,r);
+      }
+      r.status=-1;
+      return false;
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by worker_pool::request(const string& kind, const string& out, const string& id, worker_result& r)");
+   }
+}
+
+/*!
+   The process gets the slot number in DCCSO_WORKER like a worker does.
+ */
+bool worker_pool::run_once(const string& kind, const string& out, const string& id, worker_result& r)
+{
+   try {
+      int in[2], from[2];
+      if(pipe(in)!=0)
+         throw domain_error("pipe() failed");
+      if(pipe(from)!=0) {
+         close(in[0]); close(in[1]);
+         throw domain_error("pipe() failed");
+      }
+      cout.flush();
+      cerr.flush();
+      pid_t pid=fork();
+      if(pid<0) {
+         close(in[0]); close(in[1]);
+         close(from[0]); close(from[1]);
+         throw domain_error("fork() failed");
+      }
+      if(pid==0) {
+         dup2(in[0],0);
+         dup2(from[1],1);
+         close(in[0]); close(in[1]);
+         close(from[0]); close(from[1]);
+         stringstream s;
+         s << slot;
+         setenv("DCCSO_WORKER",s.str().c_str(),1);
+         string script=command+" \"$@\"";
+         execl("/bin/sh","sh","-c",script.c_str(),"sh",kind.c_str(),id.c_str(),(char*) NULL);
+         _exit(127);
+      }
+      close(in[0]);
+      close(from[1]);
+      // The process may exit without reading, which is its business.
+      write_all(in[1],out+"\n");
+      close(in[1]);
+
+      string buffer, line, record;
+      while(read_line(from[0],buffer,line))
+         if(line.compare(0,7,"RESULT ")==0) record=line;
+      if(buffer.compare(0,7,"RESULT ")==0) record=buffer;
+      close(from[0]);
+      int status;
+      waitpid(pid,&status,0);
+
+      if(!parse_result(record,id,r)) {
+         cerr << "worker_pool: " << command << " " << kind << " " << id << " sent no result" << endl;
+         r.status=-1;
+         return false;
+      }
+      return r.status==0;
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by worker_pool::run_once(const string& kind, const string& out, const string& id, worker_result& r)");
+   }
+}
+
+void worker_pool::stop()
+{
+   for(size_t k=0;k<pids.size();k++) {
+      if(pids[k]<=0) continue;
+      // Closing the requests tells the worker to exit.
+      close(to_worker[k]);
+      close(from_worker[k]);
+      waitpid(pids[k],NULL,0);
+      pids[k]=0;
+   }
+}
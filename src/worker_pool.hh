@@ -0,0 +1,130 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 3; tab-width: 3 -*- */
+/*
+ * This file is part of ARL Discrete Chemical Compound Space Optimization (ARL DCCSO) project.
+ *
+ * ARL DCSSO constitutes a work of the United States Government and is not
+ * subject to domestic copyright protection under 17 USC Sec. 105.
+ * Release authorized by the US Army Research Laboratory
+ *
+ * To the extent possible under law, the author(s) have dedicated all copyright
+ * and related and neighboring rights to this software to the public domain
+ * worldwide. This software is distributed without any warranty.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along
+ * with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+/*! @addtogroup DOChemS Discrete Optimization of Chemical Space */
+//! \file worker_pool.hh \brief Long-lived evaluator processes fed through pipes.
+
+#ifndef _WORKER_POOL_HH
+#define _WORKER_POOL_HH
+
+#include <BCR_CPP_LA/refcount.decl>
+#include <typedefs.hh>
+#include <string>
+
+using namespace linear_algebra;
+using namespace std;
+
+//! Result record of a worker.
+typedef struct {
+   //! 0 on success. Everything else is only valid on success.
+   long status;
+   double property;
+   double energy;
+   refvector<double> penalty;
+   //! Optimized constants of the Z-matrix.
+   refvector<double> consts;
+   //! Optimized variables of the Z-matrix.
+   refvector<double> vars;
+} worker_result;
+
+//! Evaluator processes that are started once and serve many requests.
+class worker_pool
+/*!
+   Instead of starting ./energy_run or ./property_script for every Z-matrix,
+   calc_energy() and calc_property() may send their requests to long-lived
+   workers (--worker <command>). The command is run by /bin/sh with its
+   standard input and output connected to the optimizer. Each worker gets its
+   slot number in the environment variable DCCSO_WORKER.
+
+   A request consists of a header line followed by the Z-matrix as it would be
+   written to id.zmat:
+   \verbatim
+   EVAL <energy|property> <id> <number of lines>
+   <lines of the Z-matrix>
+   \endverbatim
+   The worker answers with a single line
+   \verbatim
+   RESULT <id> <status> <property> <energy> <n> <penalty 1..n> <m> <constant 1..m> <k> <variable 1..k>
+   \endverbatim
+   where everything after the status may be omitted if the status is not 0.
+   The constants and variables take the place of the .rconsts and .rvars files.
+   For energy requests the property is ignored. examples/script_worker serves
+   this protocol with the usual scripts.
+
+   There is one worker per eval_pool slot and each slot talks to its own
+   worker only. A worker that dies or violates the protocol is restarted and
+   gets the request once more; only a second failure counts as a failed
+   evaluation. A missing value is reported as inf or -inf, as the files of the
+   scripts leave it; a result with NaN, or whose requested value is not
+   finite, the energy for energy requests and the property otherwise, counts
+   as failed. This holds for both modes below.
+
+   With start_per_request() (--pipe <command>), a new process is started for
+   every request instead, as the scripts are, but without the scratch files:
+   it is run as <command> <energy|property> <id>, gets the Z-matrix on its
+   standard input and writes the RESULT line above to its standard output.
+   Other lines of its output are ignored, and the last RESULT line counts.
+   The process should read its input before it writes much output, since
+   the Z-matrix is written while the output is not yet read.
+   examples/pipe_shim serves this mode with the usual scripts.
+ */
+{
+private:
+   //! Command of the workers, empty if the scripts are used.
+   static string command;
+
+   //! Whether command is started for each request rather than once per slot.
+   static bool per_request;
+
+   //! Slot whose worker serves requests of this process.
+   static long slot;
+
+   //! Start the worker of slot k.
+   static void spawn(long k);
+
+   //! Close the pipes of worker k and reap it.
+   static void discard(long k);
+
+   //! Run command for a single request.
+   static bool run_once(const string& kind, const string& out, const string& id, worker_result& r);
+public:
+   //! Start n workers running command.
+   static void start(const string& cmd, long n);
+
+   //! Serve each request by a new process running cmd.
+   static void start_per_request(const string& cmd);
+
+   //! Whether requests go to workers.
+   static bool is_active() { return command!=""; }
+
+   //! Use the worker of slot k. Called in the children of eval_pool.
+   static void set_slot(long k) { slot=k; }
+
+   //! Slot whose worker serves requests of this process.
+   static long get_slot() { return slot; }
+
+   //! Send a request and wait for its result. Returns false if the worker failed.
+   static bool request(const string& kind, const string& out, const string& id, worker_result& r);
+
+   //! Restart the workers of this process that have exited. Called by eval_pool before it forks.
+   static void check();
+
+   //! Close all pipes and wait for the workers to exit.
+   static void stop();
+};
+
+#endif
@@ -582,111 +582,6 @@ public:
          }
    }
 
-   //! Output a Z-matrix to a stringstream.
-   stringstream& zmat_to_string(long N, stringstream& output) const
-   /*!
-        \param N signifies the conformation of the combinatorial product of options.
-    */
-   {
-      long m;
-      output.str("");
-      output.precision(2);
-      output.setf(ios::fixed);
-
-      int ndihedrals=0;
-      int nconstants=0;
-      refvector<double> dihedrals;
-      refvector<double> constants;
-      if((*this).list2.dim()>0)
-         output << (*this).list[0].Name << endl;
-      if((*this).list.dim()>1) {
-         long i=1;
-         output << (*this).list[i].Name << " ";
-         for(long j=0;j<1;j++)
-            if((*this).list[i].opt_val[j] ||
-                  list[i].increment[j].size() >0) {
-               output << (*this).list[i].connect[j]+1
-                     << " dih" << ndihedrals++ << endl;
-               dihedrals.push_back((*this).list[i].variable[j]);
-               if(list[i].increment[j].size() >0)
-               {
-                  m=N % (list[i].increment[j].size()+1);
-                  N=(N-m)/(list[i].increment[j].size()+1);
-                  if(m>0)
-                     dihedrals[ndihedrals-1]+=list[i].increment[j][m-1];
-               }
-            }
-            else {
-               output << (*this).list[i].connect[j]+1
-                     << " c" << nconstants++  << endl;
-               constants.push_back((*this).list[i].variable[j]);
-            }
-      }
-      if((*this).list.dim()>2) {
-         long i=2;
-         output << (*this).list[i].Name << " ";
-         for(long j=0;j<2;j++)
-            if((*this).list[i].opt_val[j] ||
-                  list[i].increment[j].size() >0) {
-               output << (*this).list[i].connect[j]+1
-                     << " dih" << ndihedrals++ << " ";
-               dihedrals.push_back((*this).list[i].variable[j]);
-               if(list[i].increment[j].size() >0)
-               {
-                  m=N % (list[i].increment[j].size()+1);
-                  N=(N-m)/(list[i].increment[j].size()+1);
-                  if(m>0)
-                     dihedrals[ndihedrals-1]+=list[i].increment[j][m-1];
-               }
-            }
-            else {
-               output << (*this).list[i].connect[j]+1
-                     << " c" << nconstants++ << " ";
-               constants.push_back((*this).list[i].variable[j]);
-            }
-         output << endl;
-      }
-
-      for(long i=3;i<(*this).list.size(); i++) {
-         output << (*this).list[i].Name << " ";
-         for(long j=0;j<3;j++)
-            if((*this).list[i].opt_val[j] ||
-                  list[i].increment[j].size() >0) {
-               output << (*this).list[i].connect[j]+1
-                     << " dih" << ndihedrals++ << " ";
-               dihedrals.push_back((*this).list[i].variable[j]);
-               if(list[i].increment[j].size() >0)
-               {
-                  m=N % (list[i].increment[j].size()+1);
-                  N=(N-m)/(list[i].increment[j].size()+1);
-                  if(m>0)
-                     dihedrals[ndihedrals-1]+=list[i].increment[j][m-1];
-               }
-            }
-            else {
-               output << (*this).list[i].connect[j]+1
-                     << " c" << nconstants++  << " ";
-               constants.push_back((*this).list[i].variable[j]);
-            }
-         output << endl;
-      }
-
-      if(ndihedrals>0)
-      {
-         output << endl;
-         for(long i=0;i<ndihedrals;i++)
-            output << "dih" << i << " " << dihedrals[i] << endl;
-      }
-
-      if(nconstants>0)
-      {
-         output << endl;
-         for(long i=0;i<nconstants;i++)
-            output << "c" << i << " " << constants[i] << endl;
-      }
-      return output;
-   }
-
    //! Update the variables in the matrix without touching connectivity or increments.
    void update_variables(const zmat& B)
    {
@@ -21,6 +21,9 @@
 #include <typedefs.hh>
 #include <zmat.hh>
 #include <zmat_opt.hh>
+#include <eval_pool.hh>
+#include <worker_pool.hh>
+#include <evaluator_plugin.hh>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -30,15 +33,36 @@ using namespace std;
 extern valerg calc_property(const zmat& A, const string& out, const string& id, zmat& returnA, long nconstraints);
 
 //! Setup the external computations for the energy and execute them.
-/*! requires \verbatim ./energy_script\endverbatim. */
-static valerg calc_energy(const zmat& A, const string& out, const string& id, zmat& returnA, long nconstraints)
+/*! requires \verbatim ./energy_script\endverbatim, or a worker if worker_pool is active, unless an evaluator_plugin is loaded.
+    \param returnA receives A with the optimized constants and variables; if NULL, they are not read.
+ */
+static valerg calc_energy(const zmat& A, const string& out, const string& id, zmat* returnA, long nconstraints)
 {
    string s;
    valerg value;
    value.property=-INFINITY;
    value.energy=INFINITY;
    value.energy_computed=false;
-   value.penalty=refvector<double>(nconstraints);
+   value.penalty=penalty_vector(nconstraints);
+   if(evaluator_plugin::is_active()) {
+      if(returnA!=NULL)
+         return evaluator_plugin::evaluate("energy",A,out,id,*returnA,nconstraints);
+      refvector<string> outs(1), ids(1);
+      outs[0]=out;
+      ids[0]=id;
+      return evaluator_plugin::evaluate("energy",A,outs,ids,nconstraints)[0];
+   }
+   if(worker_pool::is_active()) {
+      worker_result r;
+      if(!worker_pool::request("energy",out,id,r)) return value;
+      value.energy=r.energy;
+      value.energy_computed=true;
+      if(returnA==NULL) return value;
+      *returnA=A;
+      if(r.consts.size()>=A.count_constants() && r.vars.size()>=A.count_variables())
+         returnA->set_constants_variables(r.consts,r.vars);
+      return value;
+   }
    {
       s=id+".zmat";
       ofstream output_file(s.c_str());
@@ -57,12 +81,12 @@ static valerg calc_energy(const zmat& A, const string& out, const string& id, zm
          value.energy_computed=true;
          gfile3.close();
       }
-      value.penalty=refvector<double>(nconstraints);
-      {
+      value.penalty=penalty_vector(nconstraints);
+      if(returnA!=NULL) {
          long i;
          s=id+".rconsts"; // optimized constants.
          long nconsts=A.count_constants();
-         returnA=A;
+         *returnA=A;
          refvector<double> consts(nconsts);
          ifstream gfile3 (s.c_str());
          for(i=0;gfile3.good() && i<nconsts;i++)
@@ -78,18 +102,65 @@ static valerg calc_energy(const zmat& A, const string& out, const string& id, zm
             gfile3 >> vars[i];
          gfile3.close();
          if(i<nvars) return value;
-         returnA.set_constants_variables(consts,vars);
+         returnA->set_constants_variables(consts,vars);
       }
    }
    return value;
 }
 
+//! The value of a conformer is its negative energy; the property is still to be computed.
+static valerg conformer_value(valerg val)
+{
+   val.property=val.energy;
+   val.property*=(double) -1;
+   val.property_computed=false;
+   return val;
+}
+
+//! Energy computation of a single conformation as a task for eval_pool.
+class energy_task : public eval_task
+{
+private:
+   const zmat& A;
+   string out;
+   string id;
+   long nconstraints;
+public:
+   energy_task(const zmat& Z, const string& o, const string& i, long n) :
+      A(Z), out(o), id(i), nconstraints(n)
+   {};
+
+   valerg evaluate() const
+   {
+      return conformer_value(calc_energy(A,out,id,NULL,nconstraints));
+   }
+};
+
+//! Property computation of a single conformation as a task for eval_pool.
+class property_task : public eval_task
+{
+private:
+   const zmat& A;
+   string out;
+   string id;
+   long nconstraints;
+public:
+   property_task(const zmat& Z, const string& o, const string& i, long n) :
+      A(Z), out(o), id(i), nconstraints(n)
+   {};
+
+   valerg evaluate() const
+   {
+      zmat D;
+      return calc_property(A,out,id,D,nconstraints);
+   }
+};
+
 //! Default constructor
 zmat_opt::zmat_opt():
-        Z(), Z_r(Z)
+        Z(), flat(), Z_r(Z)
 {
-   visited.resize(0);
-   value.resize(0);
+   clear_memo();
    space_size_computed=false;
    bits_computed=false;
    Library_data::Name="";
@@ -97,10 +168,11 @@ zmat_opt::zmat_opt():
 }
 //! Copy constructor
 zmat_opt::zmat_opt(const zmat_opt& A):
-        Z(A.Z_r),Z_r(Z)
+        Z(A.Z_r),flat(A.flat),Z_r(Z)
 {
    visited=A.visited;
    value=A.value;
+   memo.clear();
    Library_data::Name="";
    space_size_computed=false;
    bits_computed=false;
@@ -111,8 +183,12 @@ zmat_opt::zmat_opt(const zmat_opt& A):
 zmat_opt& zmat_opt::operator=(const zmat_opt& A)
 {
    Z=A.Z_r;
+   flat=A.flat;
    visited=A.visited;
    value=A.value;
+   memo.clear();
+   columns.clear();
+   reset_cache_key();
    Library_data::Name="";
    space_size_computed=false;
    bits_computed=false;
@@ -121,10 +197,9 @@ zmat_opt& zmat_opt::operator=(const zmat_opt& A)
 }
 
 zmat_opt::zmat_opt(const zmat& A) :
-        Z(A),Z_r(Z)
+        Z(A),flat(A),Z_r(Z)
 {
-   visited.resize(0);
-   value.resize(0);
+   clear_memo();
    Library_data::Name="";
    space_size_computed=false;
    bits_computed=false;
@@ -134,11 +209,12 @@ zmat_opt::zmat_opt(const zmat& A) :
 const zmat& zmat_opt::operator=(const zmat& A)
 {
    Z=A;
+   flat.assign(Z);
    Library_data::Name="";
    space_size_computed=false;
    bits_computed=false;
-   visited.clear();
-   value.clear();
+   clear_memo();
+   reset_cache_key();
    compute_property_flag=false;
    return Z_r;
 }
@@ -146,98 +222,196 @@ const zmat& zmat_opt::operator=(const zmat& A)
 //! Compute the energy. (Here energy is important.)
 valerg zmat_opt::compute_energy(const ulong i) const
 {
-   long j=visited.contains(i);
-   if(j>=0)
+   valerg val;
+   if(lookup(i,val))
    {
-      valerg val=value[j];
       val.property_computed=false;
       val.property=val.energy*(double) -1;
       val.penalty.zero();
       return val;
    }
 
-   static stringstream s;
-   s.str("");
+   if(cache_lookup(i,val)) {
+      memoize(i,val);
+      return val;
+   }
+
+   stringstream s;
    s << Name << i << "_"
-         << visited.size();
+         << memo_size();
 
-   stringstream out;
-   valerg val;
-   zmat D;
+   string out;
 
-   val=calc_energy(Z_r, Z.zmat_to_string(i,out).str(),s.str(),D,get_number_of_constraints());
+   val=calc_energy(Z_r, flat.conformation(i,out),s.str(),NULL,get_number_of_constraints());
    val.property=val.energy;
    val.property*=(double) -1;
    val.property_computed=false;
 
-   visited.push_back(i);
-   value.push_back(val);
+   memoize(i,val);
+   if(val.energy_computed) cache_store(i,val);
    return val;
 }
 
 //! Compute the energy. (Here energy is important.)
 valerg zmat_opt::compute_energy(const ulong i, zmat& A) const
 {
-   long j=visited.contains(i);
-   if(j>=0)
+   valerg val;
+   if(lookup(i,val))
    {
-      valerg val=value[j];
       val.property_computed=false;
       val.property=val.energy*(double) -1;
       val.penalty.zero();
       return val;
    }
 
-   static stringstream s;
-   s.str("");
+   stringstream s;
    s << Name << i << "_"
-         << visited.size();
+         << memo_size();
 
-   stringstream out;
-   valerg val;
+   string out;
 
-   val=calc_energy(Z_r, Z_r.zmat_to_string(i,out).str(),s.str(),A,get_number_of_constraints());
+   val=calc_energy(Z_r, flat.conformation(i,out),s.str(),&A,get_number_of_constraints());
    val.property=val.energy;
    val.property_computed=false;
    val.property*=(double) -1;
 
-   visited.push_back(i);
-   value.push_back(val);
+   memoize(i,val);
 
    return val;
 }
 
 
+/*!
+   Conformations that have not been visited are submitted to eval_pool at once.
+   Their ids are numbered as if they had been computed one after the other by
+   compute_energy(ulong i).
+   \return the values in the order of N.
+ */
+refvector<valerg> zmat_opt::compute_energies(const refvector<ulong>& N) const
+{
+   try {
+      refvector<ulong> pending;
+      refvector<string> outs, ids;
+      string out;
+      for(long k=0;k<N.size();k++) {
+         if(visited_index(N[k])>=0 || pending.contains(N[k])>=0) continue;
+         valerg val;
+         if(cache_lookup(N[k],val)) {
+            memoize(N[k],val);
+            continue;
+         }
+         stringstream s;
+         s << Name << N[k] << "_"
+               << memo_size()+pending.size();
+         pending.push_back(N[k]);
+         outs.push_back(flat.conformation(N[k],out));
+         ids.push_back(s.str());
+      }
+
+      refvector<valerg> vals;
+      if(evaluator_plugin::is_active()) {
+         vals=evaluator_plugin::evaluate("energy",Z_r,outs,ids,get_number_of_constraints());
+         for(long k=0;k<vals.size();k++)
+            vals[k]=conformer_value(vals[k]);
+      }
+      else {
+         refvector<const eval_task*> tasks;
+         for(long k=0;k<pending.size();k++)
+            tasks.push_back(new energy_task(Z_r,outs[k],ids[k],get_number_of_constraints()));
+         vals=eval_pool::run(tasks,get_number_of_constraints());
+         for(long k=0;k<tasks.size();k++)
+            delete tasks[k];
+      }
+      for(long k=0;k<pending.size();k++) {
+         memoize(pending[k],vals[k]);
+         if(vals[k].energy_computed) cache_store(pending[k],vals[k]);
+      }
+
+      refvector<valerg> r(N.size());
+      for(long k=0;k<N.size();k++)
+         r[k]=compute_energy(N[k]);
+      return r;
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by zmat_opt::compute_energies(const refvector<ulong>& N) const");
+   }
+}
+
+/*!
+   Without compute_property_flag this is compute_energies(). Otherwise the energies
+   of unvisited conformations are computed first, followed by all missing
+   properties in a second batch.
+   \return the values in the order of N.
+ */
+refvector<valerg> zmat_opt::compute_properties(const refvector<ulong>& N) const
+{
+   try {
+      if(!compute_property_flag) return compute_energies(N);
+      compute_energies(N);
+
+      refvector<ulong> pending;
+      refvector<string> outs, ids;
+      string out;
+      for(long k=0;k<N.size();k++) {
+         valerg val;
+         if(!lookup(N[k],val) || val.property_computed || pending.contains(N[k])>=0) continue;
+         stringstream s;
+         s << Name << N[k] << "_"
+               << visited_index(N[k]);
+         pending.push_back(N[k]);
+         outs.push_back(flat.conformation(N[k],out));
+         ids.push_back(s.str());
+      }
+
+      refvector<valerg> vals;
+      if(evaluator_plugin::is_active())
+         vals=evaluator_plugin::evaluate("property",Z_r,outs,ids,get_number_of_constraints());
+      else {
+         refvector<const eval_task*> tasks;
+         for(long k=0;k<pending.size();k++)
+            tasks.push_back(new property_task(Z_r,outs[k],ids[k],get_number_of_constraints()));
+         vals=eval_pool::run(tasks,get_number_of_constraints());
+         for(long k=0;k<tasks.size();k++)
+            delete tasks[k];
+      }
+      for(long k=0;k<pending.size();k++)
+         store_property(pending[k],vals[k],true);
+
+      // Fresh results are returned as computed, like compute_property(ulong i) does.
+      refvector<valerg> r(N.size());
+      for(long k=0;k<N.size();k++) {
+         long p=pending.contains(N[k]);
+         if(p>=0) r[k]=vals[p];
+         else lookup(N[k],r[k]);
+      }
+      return r;
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("called by zmat_opt::compute_properties(const refvector<ulong>& N) const");
+   }
+}
+
 //! Compute the property. (Here energy is important.)
 valerg zmat_opt::compute_property(const ulong i) const
 {   if(!compute_property_flag) {
       return compute_energy(i);
    }
-   long j=visited.contains(i);
-   if(j>=0 && value[j].property_computed) return value[j];
+   valerg val;
+   if(lookup(i,val) && val.property_computed) return val;
+   long j=visited_index(i);
    if(j<0) {
       compute_energy(i);
-      j=visited.contains(i);
+      j=visited_index(i);
    }
 
-   static stringstream s;
-   s.str("");
+   stringstream s;
    s << Name << i << "_"
          << j;
-   stringstream out;
-   valerg val;
+   string out;
    zmat A;
-   val=calc_property(Z_r, Z_r.zmat_to_string(i,out).str(),s.str(),A,get_number_of_constraints());
+   val=calc_property(Z_r, flat.conformation(i,out),s.str(),A,get_number_of_constraints());
 
-   if(j>=0) {
-      value[j].property=val.property;
-      value[j].property_computed=val.property_computed;
-      value[j].penalty=val.penalty;
-   }
-   else {
-      visited.push_back(i);
-      value.push_back(val);
-   }
+   store_property(i,val,true);
 
    return val;
 }
@@ -246,34 +420,46 @@ valerg zmat_opt::compute_property(const ulong i) const
 valerg zmat_opt::compute_property(const ulong i, zmat& A) const
 {
    if(!compute_property_flag) return compute_energy(i,A);
-   long j=visited.contains(i);
-   if(j>=0 && value[j].property_computed) return value[j];
+   valerg val;
+   if(lookup(i,val) && val.property_computed) return val;
+   long j=visited_index(i);
    if(j<0) {
       compute_energy(i,A);
-      j=visited.contains(i);
+      j=visited_index(i);
    }
 
-   static stringstream s;
-   s.str("");
+   stringstream s;
    s << Name << i << "_"
          << j;
-   stringstream out;
-   valerg val;
+   string out;
 
-   val=calc_property(Z_r, Z_r.zmat_to_string(i,out).str(),s.str(),A,get_number_of_constraints());
+   val=calc_property(Z_r, flat.conformation(i,out),s.str(),A,get_number_of_constraints());
 
-   if(j>=0) {
-      value[j].property=val.property;
-      value[j].property_computed=val.property_computed;
-   }
-   else {
-      visited.push_back(i);
-      value.push_back(val);
-   }
+   store_property(i,val,false);
 
    return val;
 }
 
+/*!
+   The starting geometry is part of the definition, so conformations are only
+   looked up once pre_opt() has produced the same geometry as in earlier runs.
+   Only energies are cached; properties of conformations are covered by the
+   cache of chem_opt.
+ */
+string zmat_opt::definition() const
+{
+   try {
+      stringstream s;
+      s << "zmat_opt energy\nconstraints " << get_number_of_constraints() << "\n";
+      s.precision(17);
+      Z_r.output(s);
+      return s.str();
+   } catch(exception& e) {
+      cerr << e.what() << endl;
+      throw domain_error("zmat_opt::definition() const");
+   }
+}
+
 //! Compute the size of the optimization space.
 ulong zmat_opt::get_space_size() const
 {
@@ -323,15 +509,15 @@ bool zmat_opt::pre_opt(ulong N) const
    if(current_best_val.energy!=INFINITY) {
       stringstream sid;
       sid << "./move_script "
-            << Name << "s" << number-1 << "_" << visited.size()-1 << " "
+            << Name << "s" << number-1 << "_" << memo_size()-1 << " "
             << Name << "0_0" << endl;
       number=0;
       system(sid.str().c_str());
       Z.update_variables(A);
-      visited.clear();
-      value.clear();
-      visited.push_back(0);
-      value.push_back(current_best_val);
+      flat.assign(Z);
+      clear_memo();
+      reset_cache_key();
+      memoize(0,current_best_val);
    }
    else return false;
    return true;
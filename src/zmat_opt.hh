@@ -23,6 +23,7 @@
 
 #include <typedefs.hh>
 #include <zmat.hh>
+#include <flat_zmat.hh>
 #include <Library_data.hh>
 #include <noprune.h>
 /*!
@@ -36,6 +37,8 @@ class zmat_opt:
 {
 private:
    mutable zmat Z;
+   //! Contiguous copy of Z, from which the conformations are written.
+   mutable flat_zmat flat;
 public:
    //! Read-only access to Z.
    const zmat &Z_r;
@@ -73,6 +76,12 @@ public:
    /*! This method is necessary for initialisation purposes. */
    valerg compute_energy(ulong i, zmat& A) const;
 
+   //! Compute the energies of several conformations concurrently.
+   refvector<valerg> compute_energies(const refvector<ulong>& N) const;
+
+   //! Compute the properties of several conformations concurrently.
+   refvector<valerg> compute_properties(const refvector<ulong>& N) const;
+
    //! Compute the size of the optimization space.
    ulong get_space_size() const;
 
@@ -81,6 +90,9 @@ public:
 
    //! Find a converged starting geometry.
    bool pre_opt(ulong N) const;
+
+   //! Canonical definition for the result cache: the Z-matrix with its increments.
+   string definition() const;
 };
 
 #endif